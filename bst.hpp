@@ -4,388 +4,2286 @@
 #include <iostream>
 #include <utility>
 #include <memory>
+#include <iterator>
+#include <new>
 
 #include <vector>
+#include <array>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <charconv>
+#include <stdexcept>
 #include <algorithm>
 #include <numeric>
+#include <type_traits>
+#include <cstdint>
+#include <tuple>
+#include <cmath>
+#include <future>
 
 #include <cassert>
 
-template<typename pair_type>
-struct node {
-	node* parent;
-	std::unique_ptr<node> left;
-	std::unique_ptr<node> right;
-	pair_type data;
-
-	node() = default;
+#if __cplusplus >= 202002L
+#include <compare>
+#endif
 
-	explicit node(node* parent): parent{parent}, left{}, right{}, data{} {
+//memory shared by the copies of an arena_allocator: objects are carved out of large blocks with a bump pointer,
+//and memory is reclaimed only all at once, by release() or when the arena is destroyed
+class arena {
+public:
+	explicit arena(std::size_t block_size) noexcept: _block_size{block_size}, blocks{}, current{}, available{} {
 	}
 
-	node(node* parent, const pair_type& d): parent{parent}, left{}, right{}, data{d} {
+	arena(const arena&) = delete;
+	arena& operator=(const arena&) = delete;
+
+	void* allocate(std::size_t bytes, std::size_t alignment);
+
+	void release() noexcept {
+		blocks.clear();
+		current = nullptr;
+		available = 0;
 	}
 
-	node(node* parent, pair_type&& d): parent{parent}, left{}, right{}, data{std::move(d)} {
+	std::size_t block_size() const noexcept {
+		return _block_size;
 	}
 
-	//deep copy semantics
-	node(const node& other): node{nullptr, other.data} {
-		if (other.left) {
-			left.reset(new node{*other.left});
-			left->parent = this;
-		}
-		if (other.right) {
-			right.reset(new node{*other.right});
-			right->parent = this;
-		}
+	std::size_t block_count() const noexcept {
+		return blocks.size();
 	}
+private:
+	std::size_t _block_size;
+	std::vector<std::unique_ptr<unsigned char[]>> blocks;
+	void* current;
+	std::size_t available;
+};
 
-	node& operator=(const node& other) {
-		auto tmp = node{other};
-		tmp.parent = parent;
-		return *this = std::move(tmp);
+inline void* arena::allocate(std::size_t bytes, std::size_t alignment) {
+	auto p = current;
+	auto space = available;
+	if (!std::align(alignment, bytes, p, space)) {
+		//oversized requests get a dedicated block
+		auto size = std::max(_block_size, bytes + alignment);
+		std::unique_ptr<unsigned char[]> block{new unsigned char[size]};
+		blocks.push_back(std::move(block));
+
+		p = blocks.back().get();
+		space = size;
+		p = std::align(alignment, bytes, p, space);
+		assert(p);
 	}
 
-	//take ownership of subtree
-	node(node&& other) noexcept = default;
+	current = static_cast<unsigned char*>(p) + bytes;
+	available = space - bytes;
 
-	//take ownership of subtree, retaining parent
-	node& operator=(node&& other) noexcept {
-		auto tmp = node{std::move(other)};
-		tmp.parent = parent;
-		return *this = std::move(tmp);
-	}
+	return p;
+}
 
-	virtual ~node() noexcept = default;
+//allocator over an arena: deallocate is a no-op, and release() frees every object allocated by any of its copies;
+//a container copy gets a fresh arena, so an arena_allocator should not be shared among live containers otherwise
+template<typename T>
+class arena_allocator {
+	template<typename U>
+	friend class arena_allocator;
 
-	std::size_t depth() const noexcept;
+	std::shared_ptr<arena> resource;
+public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::false_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+	using is_always_equal = std::false_type;
 
-	void clear_children() noexcept {
-		left.reset();
-		right.reset();
+	explicit arena_allocator(std::size_t block_size = 1 << 20): resource{std::make_shared<arena>(block_size)} {
 	}
 
-	node* leftmost() noexcept {
-		return _leftmost(this);
+	template<typename U>
+	arena_allocator(const arena_allocator<U>& other) noexcept: resource{other.resource} {
 	}
 
-	const node* leftmost() const noexcept {
-		return _leftmost(this);
-	}
+	T* allocate(std::size_t n) {
+		if (n > std::size_t(-1) / sizeof(T)) {
+			throw std::bad_array_new_length{};
+		}
 
-	node* first_right_ancestor() noexcept {
-		return _first_right_ancestor(this);
+		return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
 	}
 
-	const node* first_right_ancestor() const noexcept {
-		return _first_right_ancestor(this);
+	void deallocate(T*, std::size_t) noexcept {
 	}
-private:
-	template<typename node_type>
-	static node_type* _leftmost(node_type* root) noexcept;
 
-	template<typename node_type>
-	static node_type* _first_right_ancestor(node_type* root) noexcept;
-};
+	arena_allocator select_on_container_copy_construction() const {
+		return arena_allocator{resource->block_size()};
+	}
 
-template<typename P>
-std::size_t node<P>::depth() const noexcept {
-	std::size_t depth = 1;
-	auto current = this;
-	while (current->parent) {
-		current = current->parent;
-		assert(current != this);
-		++depth;
+	void release() noexcept {
+		resource->release();
 	}
 
-	return depth;
-}
+	std::size_t block_count() const noexcept {
+		return resource->block_count();
+	}
 
-template<typename P>
-template<typename node_type>
-node_type* node<P>::_leftmost(node_type* root) noexcept {
-	if (!root) {
-		return nullptr;
+	friend
+	bool operator==(const arena_allocator& lhs, const arena_allocator& rhs) noexcept {
+		return lhs.resource == rhs.resource;
 	}
 
-	node_type* current{root};
-	while (current->left) {
-		current = current->left.get();
-		assert(current != root);
+	friend
+	bool operator!=(const arena_allocator& lhs, const arena_allocator& rhs) noexcept {
+		return !(lhs == rhs);
 	}
+};
 
-	return current;
-}
+//detects allocators able to free all their objects at once (e.g. arena_allocator)
+template<typename A, typename = void>
+struct releases_in_bulk: std::false_type {
+};
 
-template<typename P>
-template<typename node_type>
-node_type* node<P>::_first_right_ancestor(node_type* root) noexcept {
-	if (!root) {
-		return nullptr;
+template<typename A>
+struct releases_in_bulk<A, std::void_t<decltype(std::declval<A&>().release())>>: std::true_type {
+};
+
+//detects comparators accepting other types than the key (e.g. std::less<>), which enable heterogeneous lookups
+template<typename C, typename = void>
+struct is_transparent: std::false_type {
+};
+
+template<typename C>
+struct is_transparent<C, std::void_t<typename C::is_transparent>>: std::true_type {
+};
+
+//detects comparators providing compare(lhs, rhs), negative, zero or positive as lhs is smaller, equivalent or greater
+//(e.g. three_way_less): searches then take one comparison per level instead of up to two
+template<typename C, typename T, typename K, typename = void>
+struct compares_three_way: std::false_type {
+};
+
+template<typename C, typename T, typename K>
+struct compares_three_way<C, T, K, std::void_t<decltype(std::declval<const C&>().compare(std::declval<const T&>(), std::declval<const K&>()))>>:
+	std::true_type {
+};
+
+template<typename T, typename = void>
+struct has_compare: std::false_type {
+};
+
+template<typename T>
+struct has_compare<T, std::void_t<decltype(std::declval<const T&>().compare(std::declval<const T&>()))>>: std::true_type {
+};
+
+//three-way comparison of keys: through operator<=> when compiled as C++20, otherwise through compare() for types
+//providing it (e.g. strings), element by element for arrays, and through operator< for anything else
+template<typename T>
+int compare_three_way(const T& lhs, const T& rhs) {
+#if defined(__cpp_lib_three_way_comparison)
+	if constexpr (std::three_way_comparable<T>) {
+		auto c = lhs <=> rhs;
+		return c < 0 ? -1 : c > 0;
+	} else
+#endif
+	if constexpr (has_compare<T>::value) {
+		return lhs.compare(rhs);
+	} else {
+		return (rhs < lhs) - (lhs < rhs);
 	}
+}
 
-	node_type* current{root};
-	while (current->parent && current == current->parent->right.get()) {
-		current = current->parent;
-		assert(current != root);
+template<typename T, std::size_t N>
+int compare_three_way(const std::array<T, N>& lhs, const std::array<T, N>& rhs) {
+	for (std::size_t i = 0; i != N; ++i) {
+		if (auto c = compare_three_way(lhs[i], rhs[i])) {
+			return c;
+		}
 	}
 
-	assert(current->parent != root);
-	return current->parent;
+	return 0;
 }
 
-template<typename node_type, typename ref_type>
-class node_iterator {
-	node_type* current;
-public:
-	using value_type = ref_type;
-	using reference = value_type&;
-	using pointer = value_type*;
-	using difference_type = std::ptrdiff_t;
-	using iterator_category = std::forward_iterator_tag;
+//drop-in replacement of std::less<T> which also provides the three-way compare
+template<typename T>
+struct three_way_less {
+	bool operator()(const T& lhs, const T& rhs) const {
+		return compare_three_way(lhs, rhs) < 0;
+	}
 
-	explicit node_iterator(node_type* n) noexcept: current{n} {
+	int compare(const T& lhs, const T& rhs) const {
+		return compare_three_way(lhs, rhs);
 	}
+};
 
-	reference operator*() const noexcept {
-		return current->data;
+//balancing policies for bst: each provides the fixups performed after a node has been linked into the tree
+//and after one has been unlinked from it; their per-node bookkeeping is kept in the two tag bits of node, so that all policies share the same node size
+//after_erase is given the parent of the position left empty (or shortened) by the unlinked node, the side of that
+//position and the tag of the node that occupied it
+//after_rebuild sets the bookkeeping of a node of a tree rebuilt by balance(), given its depth (root is 1),
+//the height of the tree and the heights of its subtrees
+struct no_balancing {
+	template<typename node_type>
+	static void after_insert(node_type*, typename node_type::pointer&) noexcept {
 	}
 
-	pointer operator->() const noexcept {
-		return &**this;
+	template<typename node_type>
+	static void after_erase(node_type*, bool, unsigned, typename node_type::pointer&) noexcept {
 	}
 
-	node_iterator& operator++() noexcept;
+	template<typename node_type>
+	static void after_rebuild(node_type*, std::size_t, std::size_t, std::size_t, std::size_t) noexcept {
+	}
+};
 
-	node_iterator operator++(int) noexcept {
-		auto tmp(*this);
-		++(*this);
-		return tmp;
+struct red_black {
+	template<typename node_type>
+	static void after_insert(node_type* n, typename node_type::pointer& root) noexcept;
+
+	template<typename node_type>
+	static void after_erase(node_type* parent, bool left, unsigned tag, typename node_type::pointer& root) noexcept;
+
+	//all levels but the last are full: colouring the last one red keeps the black height uniform
+	template<typename node_type>
+	static void after_rebuild(node_type* n, std::size_t depth, std::size_t height, std::size_t, std::size_t) noexcept {
+		set_red(n, depth > 1 && depth == height);
+	}
+private:
+	template<typename node_type>
+	static bool is_red(const node_type* n) noexcept {
+		return n && n->tag();
 	}
 
-	friend
-	bool operator==(const node_iterator& lhs, const node_iterator& rhs) noexcept {
-		return lhs.current == rhs.current;
+	template<typename node_type>
+	static void set_red(node_type* n, bool red) noexcept {
+		n->set_tag(red);
 	}
+};
 
-	friend
-	bool operator!=(const node_iterator& lhs, const node_iterator& rhs) noexcept {
-		return !(lhs == rhs);
+struct avl {
+	template<typename node_type>
+	static void after_insert(node_type* n, typename node_type::pointer& root) noexcept;
+
+	template<typename node_type>
+	static void after_erase(node_type* parent, bool left, unsigned tag, typename node_type::pointer& root) noexcept;
+
+	template<typename node_type>
+	static void after_rebuild(node_type* n, std::size_t, std::size_t, std::size_t left_height, std::size_t right_height) noexcept {
+		set_balance(n, int(right_height) - int(left_height));
+	}
+private:
+	//height of the right subtree minus height of the left one, tagged as 1 for +1 and 2 for -1
+	template<typename node_type>
+	static int balance(const node_type* n) noexcept {
+		return (n->tag() & 1) - (n->tag() >> 1);
 	}
 
-	std::size_t depth() const noexcept {
-		return current ? current->depth() : 0;
+	template<typename node_type>
+	static void set_balance(node_type* n, int balance) noexcept {
+		assert(balance >= -1 && balance <= 1);
+		n->set_tag(balance > 0 ? 1 : balance < 0 ? 2 : 0);
 	}
+
+	//restores the balance of the subtree held by owner, whose factor (passed, since it is out of the taggable range)
+	//is +2 or -2, through a single or double rotation
+	template<typename pointer>
+	static void rebalance(pointer& owner, int x_balance) noexcept;
 };
 
-template<typename N, typename R>
-node_iterator<N, R>& node_iterator<N, R>::operator++() noexcept {
-	if (current->right) {
-		current = current->right->leftmost();
-	} else if (current->parent) {
-		current = current->first_right_ancestor();
-	} else {
-		current = nullptr;
-	}
+//order statistics on top of another balancing policy: each node also stores the size of its subtree,
+//so that bst offers nth, rank and distance in O(depth)
+template<typename Balancing = no_balancing>
+struct order_statistics: Balancing {
+	static constexpr bool counted = true;
+};
 
-	return *this;
-}
+template<typename B, typename = void>
+struct counts_subtrees: std::false_type {
+};
 
-enum class KeyLocation {PARENT, LEFT, RIGHT};
+template<typename B>
+struct counts_subtrees<B, std::void_t<decltype(B::counted)>>: std::integral_constant<bool, B::counted> {
+};
 
-template<typename key_type, typename value_type, typename Comparator = std::less<key_type>>
-class bst {
-public:
-	using pair_type = std::pair<const key_type, value_type>;
+//search policy on top of another balancing policy: searches descend with one comparison per level and no branch
+//on its result, the side being an index into the children (the node equal to the key, if any, is the last one
+//the descent went left from, checked once at the bottom), and both children are prefetched before the comparison,
+//so that loading the next node overlaps it. No early exit on a match, in exchange for predictable control flow
+template<typename Balancing = no_balancing>
+struct prefetched_search: Balancing {
+	static constexpr bool prefetched = true;
+};
 
-	using node_type = node<pair_type>;
-	using iterator = node_iterator<node_type, pair_type>;
-	using const_iterator = node_iterator<node_type, const pair_type>;
+template<typename B, typename = void>
+struct prefetches_children: std::false_type {
+};
 
-	bst() = default;
+template<typename B>
+struct prefetches_children<B, std::void_t<decltype(B::prefetched)>>: std::integral_constant<bool, B::prefetched> {
+};
 
-	//deep copy semantics, retaining structure, through node constructor; recursive, pre-order traversal
-	bst(const bst& other): _size{other._size}, root{}, comparator{other.comparator} {
-		if (other.root) {
-			root.reset(new node_type{*(other.root.get())});
+//the subtree size stored by the nodes of trees with order statistics, and nothing otherwise
+template<bool counted>
+struct subtree_count {
+};
+
+template<>
+struct subtree_count<true> {
+	std::size_t _count = 1;
+};
+
+//no virtual functions, to avoid a vptr per node; the low bits of the parent pointer, always zero due to the alignment
+//of node, store a two-bit tag used by the balancing policies
+template<typename pair_type, typename allocator_type = std::allocator<pair_type>, bool counted = false>
+struct node: subtree_count<counted> {
+	using node_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<node>;
+	using node_traits = std::allocator_traits<node_allocator>;
+
+	//stateless allocators give back each node, while stateful ones must reclaim memory in bulk (like arena_allocator):
+	//storing the allocator in the deleter would double the size of the child pointers
+	struct deleter {
+		void operator()(node* n) const noexcept;
+	};
+
+	using pointer = std::unique_ptr<node, deleter>;
+
+	//storage of destroyed nodes, reused by create before asking the allocator for more; like the deleter,
+	//it gives the storage back only to stateless allocators
+	class free_list {
+	public:
+		free_list() noexcept = default;
+
+		free_list(const free_list&) = delete;
+		free_list& operator=(const free_list&) = delete;
+
+		free_list(free_list&& other) noexcept: head{other.head} {
+			other.head = nullptr;
 		}
-	}
 
-	bst& operator=(const bst& other) {
-		clear();
-		auto tmp = bst{other};
-		return *this = std::move(tmp);
-	}
+		free_list& operator=(free_list&& other) noexcept {
+			release();
+			std::swap(head, other.head);
+			return *this;
+		}
 
-	//move semantics through root's move
-	bst(bst&& other) noexcept = default;
+		~free_list() noexcept {
+			release();
+		}
 
-	bst& operator=(bst&& other) noexcept = default;
+		void push(pointer n) noexcept;
 
-	virtual ~bst() noexcept {
-		//iterative deletion of nodes
-		clear();
-	}
+		template<typename... Types>
+		pointer create(node_allocator& alloc, Types&&... args);
 
-	Comparator key_comp() const {
-		return comparator;
+		void release() noexcept;
+	private:
+		struct link {
+			link* next;
+		};
+
+		link* head = nullptr;
+	};
+
+	pointer left;
+	pointer right;
+	pair_type data;
+
+	node() = default;
+
+	explicit node(node* parent): left{}, right{}, data{}, _parent{reinterpret_cast<std::uintptr_t>(parent)} {
 	}
 
-	iterator begin() noexcept {
-		return iterator{root ? root.get()->leftmost() : nullptr};
+	node(node* parent, const pair_type& d): left{}, right{}, data{d}, _parent{reinterpret_cast<std::uintptr_t>(parent)} {
 	}
 
-	iterator end() noexcept {
-		return iterator{nullptr};
+	node(node* parent, pair_type&& d): left{}, right{}, data{std::move(d)}, _parent{reinterpret_cast<std::uintptr_t>(parent)} {
 	}
 
-	const_iterator cbegin() const noexcept {
-		return const_iterator{root ? root.get()->leftmost() : nullptr};
+	//data constructed in place from args
+	template<typename... Types>
+	node(node* parent, std::in_place_t, Types&&... args):
+		left{}, right{}, data(std::forward<Types>(args)...), _parent{reinterpret_cast<std::uintptr_t>(parent)} {
 	}
 
-	const_iterator cend() const noexcept {
-		return const_iterator{nullptr};
+	//nodes are copied through clone, which needs the allocator
+	node(const node& other) = delete;
+
+	node& operator=(const node& other) = delete;
+
+	//take ownership of subtree
+	node(node&& other) noexcept = default;
+
+	//take ownership of subtree, retaining parent
+	node& operator=(node&& other) noexcept {
+		auto tmp = node{std::move(other)};
+		tmp.set_parent(parent());
+		return *this = std::move(tmp);
 	}
 
-	const_iterator begin() const noexcept {
-		return cbegin();
+	~node() noexcept = default;
+
+	node* parent() const noexcept {
+		return reinterpret_cast<node*>(_parent & ~tag_mask);
 	}
 
-	const_iterator end() const noexcept {
-		return cend();
+	void set_parent(node* parent) noexcept {
+		_parent = reinterpret_cast<std::uintptr_t>(parent) | tag();
 	}
 
-	std::size_t size() const noexcept {
-		return _size;
+	unsigned tag() const noexcept {
+		return _parent & tag_mask;
 	}
 
-	iterator find(const key_type& key) noexcept {
-		return iterator{_find(key)};
+	void set_tag(unsigned tag) noexcept {
+		assert(tag <= tag_mask);
+		_parent = (_parent & ~tag_mask) | tag;
 	}
 
-	const_iterator find(const key_type& key) const noexcept {
-		return const_iterator{_find(key)};
+	//size of the subtree of n (zero when null), only kept when counted
+	static std::size_t count(const node* n) noexcept {
+		static_assert(counted, "subtree sizes are only kept by trees with order_statistics");
+		return n ? n->_count : 0;
 	}
 
-	std::pair<iterator, bool> insert(const pair_type& x) {
-		return _insert(x);
+	void set_count(std::size_t count) noexcept {
+		if constexpr (counted) {
+			this->_count = count;
+		}
 	}
 
-	std::pair<iterator, bool> insert(pair_type&& x) {
-		return _insert(std::move(x));
+	//recomputes the subtree size from the children's
+	void update_count() noexcept {
+		if constexpr (counted) {
+			this->_count = 1 + count(left.get()) + count(right.get());
+		}
 	}
 
 	template<typename... Types>
-	std::pair<iterator, bool> emplace(Types&&...args) {
-		return _insert(pair_type{std::forward<Types>(args)...});
-	}
+	static pointer create(node_allocator& alloc, Types&&... args);
 
-	void clear() noexcept;
+	//deep copy semantics, including the balancing bookkeeping; pre-order traversal, iterative through the parent pointers
+	//so that degenerate trees cannot overflow the stack
+	static pointer clone(const node& other, node_allocator& alloc);
 
-	void balance();
+	//clone splitting the subtrees among up to threads threads (each with its own copy of the allocator,
+	//hence only for stateless allocators: stateful ones are cloned sequentially)
+	static pointer clone(const node& other, node_allocator& alloc, std::size_t threads);
 
-	value_type& operator[](const key_type& key) {
-		return _square_brackets(key);
+	std::size_t depth() const noexcept;
+
+	void clear_children() noexcept {
+		left.reset();
+		right.reset();
 	}
 
-	value_type& operator[](key_type&& key) {
-		return _square_brackets(std::move(key));
+	//destroys the tree held by root (which has no parent) bottom-up, as the recursive destruction of the children
+	//can result in stack overflow in degenerate cases
+	static void clear(pointer& root) noexcept;
+
+	node* leftmost() noexcept {
+		return _leftmost(this);
 	}
 
-	std::size_t depth() const noexcept;
+	const node* leftmost() const noexcept {
+		return _leftmost(this);
+	}
 
-	friend
-	std::ostream& operator<<(std::ostream& os, const bst& tree) {
-		os << "bst(" << tree.size() << ") {";
-		for (const auto& p : tree) {
-			os << "(" << p.first << ": " << p.second << "), ";
-		}
+	node* first_right_ancestor() noexcept {
+		return _first_right_ancestor(this);
+	}
 
-		return os << "}";
+	const node* first_right_ancestor() const noexcept {
+		return _first_right_ancestor(this);
 	}
-private:
-	std::size_t _size;
-	std::unique_ptr<node_type> root;
-	Comparator comparator;
 
-	std::pair<node_type*, KeyLocation> find_parent_candidate(node_type* root, const key_type& key) const;
+	node* rightmost() noexcept {
+		return _rightmost(this);
+	}
 
-	node_type* _find(const key_type& key) const;
+	const node* rightmost() const noexcept {
+		return _rightmost(this);
+	}
+
+	node* first_left_ancestor() noexcept {
+		return _first_left_ancestor(this);
+	}
+
+	const node* first_left_ancestor() const noexcept {
+		return _first_left_ancestor(this);
+	}
+
+	//the unique_ptr owning n: either root or one of the parent's children
+	static pointer& owner(node* n, pointer& root) noexcept {
+		assert(n);
+		auto parent = n->parent();
+		if (!parent) {
+			return root;
+		}
+
+		return n == parent->left.get() ? parent->left : parent->right;
+	}
+
+	//rotations of the subtree held by owner, which is updated to the new subtree root
+	static void rotate_left(pointer& owner) noexcept;
+
+	static void rotate_right(pointer& owner) noexcept;
+private:
+	static constexpr std::uintptr_t tag_mask = 3;
+
+	std::uintptr_t _parent;
+
+	template<typename node_type>
+	static node_type* _leftmost(node_type* root) noexcept;
+
+	template<typename node_type>
+	static node_type* _first_right_ancestor(node_type* root) noexcept;
+
+	template<typename node_type>
+	static node_type* _rightmost(node_type* root) noexcept;
+
+	template<typename node_type>
+	static node_type* _first_left_ancestor(node_type* root) noexcept;
+};
+
+template<typename P, typename A, bool S>
+void node<P, A, S>::deleter::operator()(node* n) const noexcept {
+	if constexpr (node_traits::is_always_equal::value) {
+		node_allocator alloc{};
+		node_traits::destroy(alloc, n);
+		node_traits::deallocate(alloc, n, 1);
+	} else {
+		n->~node();
+	}
+}
+
+template<typename P, typename A, bool S>
+void node<P, A, S>::free_list::push(pointer n) noexcept {
+	auto storage = n.release();
+	if constexpr (node_traits::is_always_equal::value) {
+		node_allocator alloc{};
+		node_traits::destroy(alloc, storage);
+	} else {
+		storage->~node();
+	}
+
+	head = ::new (static_cast<void*>(storage)) link{head};
+}
+
+template<typename P, typename A, bool S>
+template<typename... Types>
+typename node<P, A, S>::pointer node<P, A, S>::free_list::create(node_allocator& alloc, Types&&... args) {
+	if (!head) {
+		return node::create(alloc, std::forward<Types>(args)...);
+	}
+
+	auto storage = reinterpret_cast<node*>(head);
+	auto next = head->next;
+	try {
+		node_traits::construct(alloc, storage, std::forward<Types>(args)...);
+	} catch (...) {
+		head = ::new (static_cast<void*>(storage)) link{next};
+		throw;
+	}
+	head = next;
+
+	return pointer{storage};
+}
+
+template<typename P, typename A, bool S>
+void node<P, A, S>::free_list::release() noexcept {
+	while (head) {
+		auto next = head->next;
+		if constexpr (node_traits::is_always_equal::value) {
+			node_allocator alloc{};
+			node_traits::deallocate(alloc, reinterpret_cast<node*>(head), 1);
+		}
+		head = next;
+	}
+}
+
+template<typename P, typename A, bool S>
+template<typename... Types>
+typename node<P, A, S>::pointer node<P, A, S>::create(node_allocator& alloc, Types&&... args) {
+	static_assert(alignof(node) > tag_mask, "the tag bits of the parent pointer must be zero");
+	auto n = node_traits::allocate(alloc, 1);
+	try {
+		node_traits::construct(alloc, n, std::forward<Types>(args)...);
+	} catch (...) {
+		node_traits::deallocate(alloc, n, 1);
+		throw;
+	}
+
+	return pointer{n};
+}
+
+template<typename P, typename A, bool S>
+typename node<P, A, S>::pointer node<P, A, S>::clone(const node& other, node_allocator& alloc) {
+	auto root = create(alloc, nullptr, other.data);
+	root->set_tag(other.tag());
+	try {
+		//source and copy are walked in lockstep: a child missing in the copy is yet to be cloned,
+		//and once both are there the walk climbs back
+		auto source = &other;
+		auto n = root.get();
+		while (true) {
+			if (source->left && !n->left) {
+				source = source->left.get();
+				n->left = create(alloc, n, source->data);
+				n = n->left.get();
+			} else if (source->right && !n->right) {
+				source = source->right.get();
+				n->right = create(alloc, n, source->data);
+				n = n->right.get();
+			} else {
+				n->update_count();
+				if (source == &other) {
+					break;
+				}
+				source = source->parent();
+				n = n->parent();
+				continue;
+			}
+			n->set_tag(source->tag());
+		}
+	} catch (...) {
+		clear(root);
+		throw;
+	}
+
+	return root;
+}
+
+template<typename P, typename A, bool S>
+void node<P, A, S>::clear(pointer& root) noexcept {
+	if (root) {
+		auto current = root->leftmost();
+		while (current) {
+			if (current->right) {
+				current = current->right->leftmost();
+			} else if (current->parent()) {
+				while (current->parent() && current == current->parent()->right.get()) {
+					current->clear_children();
+					current = current->parent();
+				}
+
+				current->clear_children();
+				current = current->parent();
+			} else {
+				current->clear_children();
+				current = nullptr;
+			}
+		}
+	}
+
+	root.reset();
+}
+
+template<typename P, typename A, bool S>
+typename node<P, A, S>::pointer node<P, A, S>::clone(const node& other, node_allocator& alloc, std::size_t threads) {
+	if (threads <= 1 || !node_traits::is_always_equal::value) {
+		return clone(other, alloc);
+	}
+
+	auto n = create(alloc, nullptr, other.data);
+	n->set_tag(other.tag());
+	//the left subtree is cloned by a new thread while this one clones the right subtree
+	std::future<pointer> left{};
+	if (other.left) {
+		left = std::async(std::launch::async, [&other, threads]() {
+			node_allocator alloc{};
+			return clone(*other.left, alloc, threads / 2);
+		});
+	}
+	if (other.right) {
+		n->right = clone(*other.right, alloc, threads - threads / 2);
+		n->right->set_parent(n.get());
+	}
+	if (other.left) {
+		n->left = left.get();
+		n->left->set_parent(n.get());
+	}
+	n->update_count();
+
+	return n;
+}
+
+template<typename P, typename A, bool S>
+void node<P, A, S>::rotate_left(pointer& owner) noexcept {
+	assert(owner && owner->right);
+	auto x = owner.get();
+	pointer y{std::move(x->right)};
+	x->right = std::move(y->left);
+	if (x->right) {
+		x->right->set_parent(x);
+	}
+
+	y->set_parent(x->parent());
+	x->set_parent(y.get());
+	y->left = std::move(owner);
+	x->update_count();
+	y->update_count();
+	owner = std::move(y);
+}
+
+template<typename P, typename A, bool S>
+void node<P, A, S>::rotate_right(pointer& owner) noexcept {
+	assert(owner && owner->left);
+	auto x = owner.get();
+	pointer y{std::move(x->left)};
+	x->left = std::move(y->right);
+	if (x->left) {
+		x->left->set_parent(x);
+	}
+
+	y->set_parent(x->parent());
+	x->set_parent(y.get());
+	y->right = std::move(owner);
+	x->update_count();
+	y->update_count();
+	owner = std::move(y);
+}
+
+template<typename P, typename A, bool S>
+std::size_t node<P, A, S>::depth() const noexcept {
+	std::size_t depth = 1;
+	auto current = this;
+	while (current->parent()) {
+		current = current->parent();
+		assert(current != this);
+		++depth;
+	}
+
+	return depth;
+}
+
+template<typename P, typename A, bool S>
+template<typename node_type>
+node_type* node<P, A, S>::_leftmost(node_type* root) noexcept {
+	if (!root) {
+		return nullptr;
+	}
+
+	node_type* current{root};
+	while (current->left) {
+		current = current->left.get();
+		assert(current != root);
+	}
+
+	return current;
+}
+
+template<typename P, typename A, bool S>
+template<typename node_type>
+node_type* node<P, A, S>::_first_right_ancestor(node_type* root) noexcept {
+	if (!root) {
+		return nullptr;
+	}
+
+	node_type* current{root};
+	while (current->parent() && current == current->parent()->right.get()) {
+		current = current->parent();
+		assert(current != root);
+	}
+
+	assert(current->parent() != root);
+	return current->parent();
+}
+
+template<typename P, typename A, bool S>
+template<typename node_type>
+node_type* node<P, A, S>::_rightmost(node_type* root) noexcept {
+	if (!root) {
+		return nullptr;
+	}
+
+	node_type* current{root};
+	while (current->right) {
+		current = current->right.get();
+		assert(current != root);
+	}
+
+	return current;
+}
+
+template<typename P, typename A, bool S>
+template<typename node_type>
+node_type* node<P, A, S>::_first_left_ancestor(node_type* root) noexcept {
+	if (!root) {
+		return nullptr;
+	}
+
+	node_type* current{root};
+	while (current->parent() && current == current->parent()->left.get()) {
+		current = current->parent();
+		assert(current != root);
+	}
+
+	assert(current->parent() != root);
+	return current->parent();
+}
+
+template<typename node_type>
+void red_black::after_insert(node_type* n, typename node_type::pointer& root) noexcept {
+	assert(n);
+	set_red(n, true);
+	while (is_red(n->parent())) {
+		auto p = n->parent();
+		//a red node is never the root
+		auto g = p->parent();
+		assert(g);
+		if (p == g->left.get()) {
+			auto u = g->right.get();
+			if (is_red(u)) {
+				set_red(p, false);
+				set_red(u, false);
+				set_red(g, true);
+				n = g;
+			} else {
+				if (n == p->right.get()) {
+					node_type::rotate_left(node_type::owner(p, root));
+					p = n;
+				}
+				set_red(p, false);
+				set_red(g, true);
+				node_type::rotate_right(node_type::owner(g, root));
+				//the subtree is now rooted in the black p
+				break;
+			}
+		} else {
+			auto u = g->left.get();
+			if (is_red(u)) {
+				set_red(p, false);
+				set_red(u, false);
+				set_red(g, true);
+				n = g;
+			} else {
+				if (n == p->left.get()) {
+					node_type::rotate_right(node_type::owner(p, root));
+					p = n;
+				}
+				set_red(p, false);
+				set_red(g, true);
+				node_type::rotate_left(node_type::owner(g, root));
+				//the subtree is now rooted in the black p
+				break;
+			}
+		}
+	}
+
+	set_red(root.get(), false);
+}
+
+template<typename pointer>
+void avl::rebalance(pointer& owner, int x_balance) noexcept {
+	using node_type = typename pointer::element_type;
+	auto x = owner.get();
+	//z is the taller child, y its child on the inner side
+	auto right_heavy = x_balance > 0;
+	auto z = right_heavy ? x->right.get() : x->left.get();
+	auto sign = right_heavy ? 1 : -1;
+	auto z_balance = balance(z) * sign;
+	if (z_balance >= 0) {
+		//single rotation: only a zero factor in z (possible after an erasure) leaves the subtree height unchanged
+		set_balance(x, z_balance ? 0 : sign);
+		set_balance(z, z_balance ? 0 : -sign);
+		if (right_heavy) {
+			node_type::rotate_left(owner);
+		} else {
+			node_type::rotate_right(owner);
+		}
+	} else {
+		auto y = right_heavy ? z->left.get() : z->right.get();
+		auto y_balance = balance(y) * sign;
+		set_balance(x, y_balance > 0 ? -sign : 0);
+		set_balance(z, y_balance < 0 ? sign : 0);
+		set_balance(y, 0);
+		if (right_heavy) {
+			node_type::rotate_right(x->right);
+			node_type::rotate_left(owner);
+		} else {
+			node_type::rotate_left(x->left);
+			node_type::rotate_right(owner);
+		}
+	}
+}
+
+template<typename node_type>
+void avl::after_insert(node_type* n, typename node_type::pointer& root) noexcept {
+	//retrace towards the root until a subtree's height is unchanged
+	for (auto p = n->parent(); p; n = p, p = p->parent()) {
+		auto b = balance(p) + (n == p->right.get() ? 1 : -1);
+		if (b == 0) {
+			set_balance(p, b);
+			break;
+		}
+		if (b != 1 && b != -1) {
+			//after an insertion, a rotation restores the height the subtree had before
+			rebalance(node_type::owner(p, root), b);
+			break;
+		}
+		set_balance(p, b);
+	}
+}
+
+template<typename node_type>
+void red_black::after_erase(node_type* parent, bool left, unsigned tag, typename node_type::pointer& root) noexcept {
+	//unlinking a red node leaves the black height unchanged
+	if (tag) {
+		return;
+	}
+
+	//the subtree at x lacks a black node: it is either coloured in x, if red, or moved up towards the root
+	auto x = parent ? (left ? parent->left.get() : parent->right.get()) : root.get();
+	while (parent && !is_red(x)) {
+		//the sibling of x is never null, as its subtree has a black height of at least one
+		if (left) {
+			auto w = parent->right.get();
+			if (is_red(w)) {
+				set_red(w, false);
+				set_red(parent, true);
+				node_type::rotate_left(node_type::owner(parent, root));
+				w = parent->right.get();
+			}
+			if (!is_red(w->left.get()) && !is_red(w->right.get())) {
+				set_red(w, true);
+				x = parent;
+			} else {
+				if (!is_red(w->right.get())) {
+					set_red(w->left.get(), false);
+					set_red(w, true);
+					node_type::rotate_right(parent->right);
+					w = parent->right.get();
+				}
+				set_red(w, is_red(parent));
+				set_red(parent, false);
+				set_red(w->right.get(), false);
+				node_type::rotate_left(node_type::owner(parent, root));
+				return;
+			}
+		} else {
+			auto w = parent->left.get();
+			if (is_red(w)) {
+				set_red(w, false);
+				set_red(parent, true);
+				node_type::rotate_right(node_type::owner(parent, root));
+				w = parent->left.get();
+			}
+			if (!is_red(w->right.get()) && !is_red(w->left.get())) {
+				set_red(w, true);
+				x = parent;
+			} else {
+				if (!is_red(w->left.get())) {
+					set_red(w->right.get(), false);
+					set_red(w, true);
+					node_type::rotate_left(parent->left);
+					w = parent->left.get();
+				}
+				set_red(w, is_red(parent));
+				set_red(parent, false);
+				set_red(w->left.get(), false);
+				node_type::rotate_right(node_type::owner(parent, root));
+				return;
+			}
+		}
+
+		parent = x->parent();
+		left = parent && x == parent->left.get();
+	}
+
+	if (x) {
+		set_red(x, false);
+	}
+}
+
+template<typename node_type>
+void avl::after_erase(node_type* parent, bool left, unsigned, typename node_type::pointer& root) noexcept {
+	//retrace towards the root while the subtree on the given side of p got shorter
+	for (auto p = parent; p;) {
+		auto b = balance(p) + (left ? 1 : -1);
+		auto next = p->parent();
+		auto next_left = next && p == next->left.get();
+		if (b == 1 || b == -1) {
+			//p was balanced: its height is unchanged
+			set_balance(p, b);
+			break;
+		}
+		if (b == 0) {
+			set_balance(p, b);
+		} else {
+			//the rotation leaves the height unchanged only when the taller child was balanced
+			auto z = b > 0 ? p->right.get() : p->left.get();
+			auto shorter = balance(z) != 0;
+			rebalance(node_type::owner(p, root), b);
+			if (!shorter) {
+				break;
+			}
+		}
+
+		p = next;
+		left = next_left;
+	}
+}
+
+
+template<typename key_type, typename value_type, typename Comparator, typename Balancing, typename Allocator>
+class bst;
+
+template<typename node_type, typename ref_type>
+class node_iterator {
+	template<typename, typename>
+	friend class node_iterator;
+
+	template<typename, typename, typename, typename, typename>
+	friend class bst;
+
+	node_type* current;
+	//the end iterator (a null current) is decremented to the rightmost node of the tree
+	const typename node_type::pointer* root;
+public:
+	using value_type = ref_type;
+	using reference = value_type&;
+	using pointer = value_type*;
+	using difference_type = std::ptrdiff_t;
+	using iterator_category = std::bidirectional_iterator_tag;
+
+	node_iterator(node_type* n, const typename node_type::pointer& root) noexcept: current{n}, root{&root} {
+	}
+
+	//iterator to const_iterator conversion
+	template<typename other_ref, typename = std::enable_if_t<std::is_convertible<other_ref*, ref_type*>::value>>
+	node_iterator(const node_iterator<node_type, other_ref>& other) noexcept: current{other.current}, root{other.root} {
+	}
+
+	reference operator*() const noexcept {
+		return current->data;
+	}
+
+	pointer operator->() const noexcept {
+		return &**this;
+	}
+
+	node_iterator& operator++() noexcept;
+
+	node_iterator operator++(int) noexcept {
+		auto tmp(*this);
+		++(*this);
+		return tmp;
+	}
+
+	node_iterator& operator--() noexcept;
+
+	node_iterator operator--(int) noexcept {
+		auto tmp(*this);
+		--(*this);
+		return tmp;
+	}
+
+	friend
+	bool operator==(const node_iterator& lhs, const node_iterator& rhs) noexcept {
+		return lhs.current == rhs.current;
+	}
+
+	friend
+	bool operator!=(const node_iterator& lhs, const node_iterator& rhs) noexcept {
+		return !(lhs == rhs);
+	}
+
+	std::size_t depth() const noexcept {
+		return current ? current->depth() : 0;
+	}
+};
+
+template<typename N, typename R>
+node_iterator<N, R>& node_iterator<N, R>::operator++() noexcept {
+	if (current->right) {
+		current = current->right->leftmost();
+	} else if (current->parent()) {
+		current = current->first_right_ancestor();
+	} else {
+		current = nullptr;
+	}
+
+	return *this;
+}
+
+template<typename N, typename R>
+node_iterator<N, R>& node_iterator<N, R>::operator--() noexcept {
+	if (!current) {
+		current = (*root)->rightmost();
+	} else if (current->left) {
+		current = current->left->rightmost();
+	} else {
+		current = current->first_left_ancestor();
+	}
+
+	return *this;
+}
+
+//pair of iterators, to be traversed by range-based for loops
+template<typename iterator_type>
+class iterator_range {
+	iterator_type first;
+	iterator_type last;
+public:
+	iterator_range(iterator_type first, iterator_type last) noexcept: first{first}, last{last} {
+	}
+
+	iterator_type begin() const noexcept {
+		return first;
+	}
+
+	iterator_type end() const noexcept {
+		return last;
+	}
+
+	bool empty() const noexcept {
+		return first == last;
+	}
+};
+
+//shape of a tree as computed by bst::shape_stats(), with depths starting from 1 at the root
+struct tree_shape {
+	std::size_t size = 0;
+	std::size_t max_depth = 0;
+	double average_depth = 0;
+	std::size_t leaves = 0;
+	//number of nodes at each depth, the root's first
+	std::vector<std::size_t> levels{};
+
+	//fraction of the slots of a level (levels[level] out of 2^level) holding a node
+	double fill(std::size_t level) const noexcept {
+		return std::ldexp(double(levels[level]), -int(std::min<std::size_t>(level, 4096)));
+	}
+
+	//the levels beyond the first 64 are elided
+	friend
+	std::ostream& operator<<(std::ostream& os, const tree_shape& shape) {
+		os << "size: " << shape.size << " max depth: " << shape.max_depth << " average depth: " << shape.average_depth
+			<< " leaves: " << shape.leaves << " levels (nodes fill%):";
+		for (std::size_t level = 0; level != std::min<std::size_t>(shape.levels.size(), 64); ++level) {
+			os << " " << shape.levels[level] << " " << shape.fill(level) * 100 << "%";
+		}
+		if (shape.levels.size() > 64) {
+			os << " ...";
+		}
+
+		return os;
+	}
+};
+
+enum class KeyLocation {PARENT, LEFT, RIGHT};
+
+//tags a range as sorted by the tree's comparator and free of duplicate keys
+struct sorted_unique_t {
+};
+
+constexpr sorted_unique_t sorted_unique{};
+
+//text of a key or a value for bst::dump, written to [first, last): returns the end of the text, or nullptr if it does not fit.
+//arithmetic types go through std::to_chars (chars as characters, bools as 0 or 1 and floating-point numbers with
+//6 significant digits in general form, as operator<< prints them with the default flags), strings
+//are copied and arrays are listed between brackets; any other type is printed by operator<< to an ostringstream,
+//the only case that allocates
+template<typename T, std::size_t N>
+char* format_chars(char* first, char* last, const std::array<T, N>& x);
+
+template<typename T>
+char* format_chars(char* first, char* last, const T& x) {
+	if constexpr (std::is_same<T, bool>::value) {
+		return format_chars(first, last, static_cast<int>(x));
+	} else if constexpr (std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value) {
+		if (first == last) {
+			return nullptr;
+		}
+		*first = x;
+		return first + 1;
+	} else if constexpr (std::is_floating_point<T>::value) {
+		auto result = std::to_chars(first, last, x, std::chars_format::general, 6);
+		return result.ec == std::errc{} ? result.ptr : nullptr;
+	} else if constexpr (std::is_arithmetic<T>::value) {
+		auto result = std::to_chars(first, last, x);
+		return result.ec == std::errc{} ? result.ptr : nullptr;
+	} else if constexpr (std::is_convertible<const T&, std::string_view>::value) {
+		std::string_view text{x};
+		if (static_cast<std::size_t>(last - first) < text.size()) {
+			return nullptr;
+		}
+		return std::copy(text.begin(), text.end(), first);
+	} else {
+		std::ostringstream os;
+		os << x;
+		return format_chars(first, last, os.str());
+	}
+}
+
+template<typename T, std::size_t N>
+char* format_chars(char* first, char* last, const std::array<T, N>& x) {
+	first = format_chars(first, last, "[");
+	for (std::size_t i = 0; first && i != N; ++i) {
+		first = i ? format_chars(first, last, ", ") : first;
+		first = first ? format_chars(first, last, x[i]) : first;
+	}
+
+	return first ? format_chars(first, last, "]") : first;
+}
+
+//Balancing selects how the tree is kept balanced on insertion: no_balancing (shape depends on the insertion order,
+//balance() can be called to rebuild the tree), red_black or avl (depth is always O(log n)); any of them can be
+//wrapped in order_statistics, for nth, rank and distance, and in prefetched_search, for branch-free descents
+//Allocator is rebound to the nodes; a stateful allocator must reclaim its memory in bulk, like arena_allocator
+template<typename key_type, typename value_type, typename Comparator = std::less<key_type>, typename Balancing = no_balancing,
+	typename Allocator = std::allocator<std::pair<const key_type, value_type>>>
+class bst {
+public:
+	using pair_type = std::pair<const key_type, value_type>;
+	using allocator_type = Allocator;
+
+	using node_type = node<pair_type, Allocator, counts_subtrees<Balancing>::value>;
+	using iterator = node_iterator<node_type, pair_type>;
+	using const_iterator = node_iterator<node_type, const pair_type>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	//enables the heterogeneous lookups for T, given a transparent Comparator
+	template<typename T, typename C = Comparator>
+	using transparent_key = std::enable_if_t<is_transparent<C>::value && !std::is_same<std::decay_t<T>, key_type>::value>;
+
+	bst() = default;
+
+	explicit bst(const Allocator& alloc): _size{}, comparator{}, alloc{alloc}, recycled{}, root{} {
+	}
+
+	template<typename InputIt>
+	bst(sorted_unique_t, InputIt first, InputIt last, const Comparator& comparator = Comparator{}, const Allocator& alloc = Allocator{}):
+		_size{}, comparator{comparator}, alloc{alloc}, recycled{}, root{} {
+		assign_sorted(first, last);
+	}
+
+	//deep copy semantics, retaining structure, through node clone; the copy gets its own allocator
+	bst(const bst& other): _size{other._size}, comparator{other.comparator},
+		alloc{node_traits::select_on_container_copy_construction(other.alloc)}, recycled{}, root{} {
+		if (other.root) {
+			root = node_type::clone(*other.root, alloc);
+			rightmost = root->rightmost();
+		}
+	}
+
+	//copy cloned by up to threads threads, see parallel_threshold
+	bst(const bst& other, std::size_t threads): _size{other._size}, comparator{other.comparator},
+		alloc{node_traits::select_on_container_copy_construction(other.alloc)}, recycled{}, root{} {
+		if (other.root) {
+			root = node_type::clone(*other.root, alloc, parallel_threads(threads));
+			rightmost = root->rightmost();
+		}
+	}
+
+	//copy and move: if the copy throws the tree is left unchanged, and self-assignment keeps the elements
+	bst& operator=(const bst& other) {
+		auto tmp = bst{other};
+		return *this = std::move(tmp);
+	}
+
+	//move semantics through root's move; the allocator goes along with the nodes,
+	//while other gets a fresh one so that clearing it cannot release the moved nodes: a stateful allocator may
+	//throw while making it (e.g. arena_allocator allocates a new arena), before anything is moved
+	bst(bst&& other) noexcept(node_traits::is_always_equal::value): _size{}, comparator{other.comparator}, alloc{other.alloc},
+		recycled{}, root{} {
+		auto fresh = node_traits::select_on_container_copy_construction(alloc);
+		_size = other._size;
+		recycled = std::move(other.recycled);
+		root = std::move(other.root);
+		rightmost = other.rightmost;
+
+		other._size = 0;
+		other.rightmost = nullptr;
+		other.alloc = std::move(fresh);
+	}
+
+	bst& operator=(bst&& other) noexcept(node_traits::is_always_equal::value) {
+		auto fresh = node_traits::select_on_container_copy_construction(other.alloc);
+		clear();
+		_size = other._size;
+		comparator = std::move(other.comparator);
+		alloc = other.alloc;
+		recycled = std::move(other.recycled);
+		root = std::move(other.root);
+		rightmost = other.rightmost;
+
+		other._size = 0;
+		other.rightmost = nullptr;
+		other.alloc = std::move(fresh);
+
+		return *this;
+	}
+
+	virtual ~bst() noexcept {
+		//iterative deletion of nodes
+		clear();
+	}
+
+	Comparator key_comp() const {
+		return comparator;
+	}
+
+	allocator_type get_allocator() const {
+		return allocator_type{alloc};
+	}
+
+	iterator begin() noexcept {
+		return iterator{root ? root.get()->leftmost() : nullptr, root};
+	}
+
+	iterator end() noexcept {
+		return iterator{nullptr, root};
+	}
+
+	const_iterator cbegin() const noexcept {
+		return const_iterator{root ? root.get()->leftmost() : nullptr, root};
+	}
+
+	const_iterator cend() const noexcept {
+		return const_iterator{nullptr, root};
+	}
+
+	const_iterator begin() const noexcept {
+		return cbegin();
+	}
+
+	const_iterator end() const noexcept {
+		return cend();
+	}
+
+	reverse_iterator rbegin() noexcept {
+		return reverse_iterator{end()};
+	}
+
+	reverse_iterator rend() noexcept {
+		return reverse_iterator{begin()};
+	}
+
+	const_reverse_iterator crbegin() const noexcept {
+		return const_reverse_iterator{cend()};
+	}
+
+	const_reverse_iterator crend() const noexcept {
+		return const_reverse_iterator{cbegin()};
+	}
+
+	const_reverse_iterator rbegin() const noexcept {
+		return crbegin();
+	}
+
+	const_reverse_iterator rend() const noexcept {
+		return crend();
+	}
+
+	std::size_t size() const noexcept {
+		return _size;
+	}
+
+	iterator find(const key_type& key) noexcept {
+		return iterator{_find(key), root};
+	}
+
+	const_iterator find(const key_type& key) const noexcept {
+		return const_iterator{_find(key), root};
+	}
+
+	//with a transparent Comparator, the lookups also accept any type it compares with keys, which is not converted
+	//to key_type (e.g. a string_view looked up among string keys)
+	template<typename T, typename = transparent_key<T>>
+	iterator find(const T& key) {
+		return iterator{_find(key), root};
+	}
+
+	template<typename T, typename = transparent_key<T>>
+	const_iterator find(const T& key) const {
+		return const_iterator{_find(key), root};
+	}
+
+	//first element whose key is not smaller than key
+	iterator lower_bound(const key_type& key) {
+		return iterator{_bound(key, false), root};
+	}
+
+	const_iterator lower_bound(const key_type& key) const {
+		return const_iterator{_bound(key, false), root};
+	}
+
+	template<typename T, typename = transparent_key<T>>
+	iterator lower_bound(const T& key) {
+		return iterator{_bound(key, false), root};
+	}
+
+	template<typename T, typename = transparent_key<T>>
+	const_iterator lower_bound(const T& key) const {
+		return const_iterator{_bound(key, false), root};
+	}
+
+	//first element whose key is greater than key
+	iterator upper_bound(const key_type& key) {
+		return iterator{_bound(key, true), root};
+	}
+
+	const_iterator upper_bound(const key_type& key) const {
+		return const_iterator{_bound(key, true), root};
+	}
+
+	template<typename T, typename = transparent_key<T>>
+	iterator upper_bound(const T& key) {
+		return iterator{_bound(key, true), root};
+	}
+
+	template<typename T, typename = transparent_key<T>>
+	const_iterator upper_bound(const T& key) const {
+		return const_iterator{_bound(key, true), root};
+	}
+
+	std::pair<iterator, iterator> equal_range(const key_type& key) {
+		auto bounds = _equal_range(key);
+		return std::make_pair(iterator{bounds.first, root}, iterator{bounds.second, root});
+	}
+
+	std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const {
+		auto bounds = _equal_range(key);
+		return std::make_pair(const_iterator{bounds.first, root}, const_iterator{bounds.second, root});
+	}
+
+	template<typename T, typename = transparent_key<T>>
+	std::pair<iterator, iterator> equal_range(const T& key) {
+		auto bounds = _equal_range(key);
+		return std::make_pair(iterator{bounds.first, root}, iterator{bounds.second, root});
+	}
+
+	template<typename T, typename = transparent_key<T>>
+	std::pair<const_iterator, const_iterator> equal_range(const T& key) const {
+		auto bounds = _equal_range(key);
+		return std::make_pair(const_iterator{bounds.first, root}, const_iterator{bounds.second, root});
+	}
+
+	//the elements whose keys are in [lo, hi), found in O(log n) and traversed in O(k); empty unless lo is smaller than hi
+	iterator_range<iterator> range(const key_type& lo, const key_type& hi) {
+		auto bounds = _range(lo, hi);
+		return iterator_range<iterator>{iterator{bounds.first, root}, iterator{bounds.second, root}};
+	}
+
+	iterator_range<const_iterator> range(const key_type& lo, const key_type& hi) const {
+		auto bounds = _range(lo, hi);
+		return iterator_range<const_iterator>{const_iterator{bounds.first, root}, const_iterator{bounds.second, root}};
+	}
+
+	template<typename T, typename U, typename = transparent_key<T>, typename = transparent_key<U>>
+	iterator_range<iterator> range(const T& lo, const U& hi) {
+		auto bounds = _range(lo, hi);
+		return iterator_range<iterator>{iterator{bounds.first, root}, iterator{bounds.second, root}};
+	}
+
+	template<typename T, typename U, typename = transparent_key<T>, typename = transparent_key<U>>
+	iterator_range<const_iterator> range(const T& lo, const U& hi) const {
+		auto bounds = _range(lo, hi);
+		return iterator_range<const_iterator>{const_iterator{bounds.first, root}, const_iterator{bounds.second, root}};
+	}
+
+	//order statistics, available when Balancing is order_statistics<...>: the element at index k in sorted order
+	//(end() when k is not smaller than size()), the number of keys smaller than key, and the number of increments
+	//from first to last, all in O(depth)
+	iterator nth(std::size_t k) noexcept {
+		return iterator{_nth(k), root};
+	}
+
+	const_iterator nth(std::size_t k) const noexcept {
+		return const_iterator{_nth(k), root};
+	}
+
+	std::size_t rank(const key_type& key) const {
+		return _rank(key);
+	}
+
+	template<typename T, typename = transparent_key<T>>
+	std::size_t rank(const T& key) const {
+		return _rank(key);
+	}
+
+	std::ptrdiff_t distance(const_iterator first, const_iterator last) const noexcept {
+		return std::ptrdiff_t(_index(last.current)) - std::ptrdiff_t(_index(first.current));
+	}
+
+	//writes to out the result of find for each key in [first, last): a sorted batch is walked once,
+	//restarting each search from where the previous one ended, otherwise groups of searches are interleaved
+	template<typename ForwardIt, typename OutputIt>
+	OutputIt find_many(ForwardIt first, ForwardIt last, OutputIt out) {
+		return _find_many<iterator>(first, last, out);
+	}
+
+	template<typename ForwardIt, typename OutputIt>
+	OutputIt find_many(ForwardIt first, ForwardIt last, OutputIt out) const {
+		return _find_many<const_iterator>(first, last, out);
+	}
+
+	std::pair<iterator, bool> insert(const pair_type& x) {
+		return _insert(x);
+	}
+
+	std::pair<iterator, bool> insert(pair_type&& x) {
+		return _insert(std::move(x));
+	}
+
+	//the pair is constructed directly in a new node, which goes back to the free list if the key is already present
+	template<typename... Types>
+	std::pair<iterator, bool> emplace(Types&&...args) {
+		auto n = recycled.create(alloc, nullptr, std::in_place, std::forward<Types>(args)...);
+		auto inserted = _insert(std::move(n));
+		if (n) {
+			recycled.push(std::move(n));
+		}
+		return inserted;
+	}
+
+	//a key followed by a value is looked up first, as in try_emplace
+	template<typename O, typename P, typename = std::enable_if_t<std::is_same<std::decay_t<O>, key_type>::value>>
+	std::pair<iterator, bool> emplace(O&& key, P&& value) {
+		return _try_emplace(std::forward<O>(key), std::forward<P>(value));
+	}
+
+	//the pair is constructed (in place, from key and args) only when key is not already present
+	template<typename... Types>
+	std::pair<iterator, bool> try_emplace(const key_type& key, Types&&...args) {
+		return _try_emplace(key, std::forward<Types>(args)...);
+	}
+
+	template<typename... Types>
+	std::pair<iterator, bool> try_emplace(key_type&& key, Types&&...args) {
+		return _try_emplace(std::move(key), std::forward<Types>(args)...);
+	}
+
+	//hinted insertions: when x belongs right before or right after hint, it is linked there with at most
+	//two comparisons, otherwise the search starts from the lowest ancestor of hint whose subtree can contain x
+	iterator insert(const_iterator hint, const pair_type& x) {
+		return _insert_hint(hint, x);
+	}
+
+	iterator insert(const_iterator hint, pair_type&& x) {
+		return _insert_hint(hint, std::move(x));
+	}
+
+	template<typename... Types>
+	iterator emplace_hint(const_iterator hint, Types&&...args) {
+		auto n = recycled.create(alloc, nullptr, std::in_place, std::forward<Types>(args)...);
+		auto inserted = _insert_hint(hint, std::move(n));
+		if (n) {
+			recycled.push(std::move(n));
+		}
+		return inserted;
+	}
+
+	//erasures unlink the node without moving any other, so only the iterators to the erased elements are invalidated;
+	//the node storage is kept for the following insertions, until clear()
+	iterator erase(const_iterator pos) noexcept {
+		return _erase(pos.current);
+	}
+
+	iterator erase(iterator pos) noexcept {
+		return _erase(pos.current);
+	}
+
+	iterator erase(const_iterator first, const_iterator last) noexcept;
+
+	std::size_t erase(const key_type& key) {
+		return _erase_key(key);
+	}
+
+	//not chosen for iterators, which erase the element they point to
+	template<typename T, typename = transparent_key<T>, typename = std::enable_if_t<!std::is_convertible<T, const_iterator>::value>>
+	std::size_t erase(const T& key) {
+		return _erase_key(key);
+	}
+
+	void clear() noexcept;
+
+	//set operations in O(n + m) comparisons, walking both trees in order, after which the result is relinked into
+	//a tree of minimal height; the nodes of this tree stay where they are, so iterators to the remaining elements
+	//stay valid. If the comparator throws, both trees are left valid, each with a part of the elements
+
+	//moves the elements of other whose key is missing here into this tree, relinking their nodes if the allocators
+	//compare equal (copying, and destroying the originals, otherwise); the others remain in other, as in std::map::merge
+	void merge(bst& other);
+
+	void merge(bst&& other) {
+		merge(other);
+	}
+
+	//inserts copies of the elements of other whose key is missing here
+	void union_with(const bst& other);
+
+	//erases the elements whose key is missing in other (their nodes are kept for the following insertions, as by erase)
+	void intersect_with(const bst& other);
+
+	//erases the elements whose key is present in other
+	void difference(const bst& other);
+
+	//relinks the existing nodes into a tree of minimal height, without comparisons nor allocations
+	void balance() noexcept;
+
+	//balance() splitting the relinking among up to threads threads, see parallel_threshold; the nodes are first
+	//listed in order, which takes one pointer per node (balance() is used instead if that allocation fails)
+	void balance(std::size_t threads) noexcept;
+
+	//the parallel copy and balance use at most one thread every parallel_threshold nodes, so that smaller trees
+	//are processed sequentially; the subtrees are split among threads from the top, so the speedup depends on the shape
+	static constexpr std::size_t parallel_threshold = 1 << 16;
+
+	//replaces the content with the pairs in [first, last), which must be sorted by key_comp() without duplicate keys
+	//(checked by assertions); the nodes are allocated in one pass and linked into a balanced tree without comparisons
+	template<typename InputIt>
+	void assign_sorted(InputIt first, InputIt last);
+
+	value_type& operator[](const key_type& key) {
+		return _square_brackets(key);
+	}
+
+	value_type& operator[](key_type&& key) {
+		return _square_brackets(std::move(key));
+	}
+
+	//the key is constructed from key only when it is missing
+	template<typename T, typename = transparent_key<T>>
+	value_type& operator[](T&& key) {
+		return _square_brackets(std::forward<T>(key));
+	}
+
+	//both are computed in a single O(n) pass
+	std::size_t depth() const noexcept;
+
+	tree_shape shape_stats() const;
+
+	//writes the text of operator<< with the default stream flags through write(const char* data, std::size_t size), called whenever the capacity bytes
+	//of buffer are full and once at the end; keys and values are formatted by format_chars, so nothing is allocated
+	//for arithmetic types, strings and arrays of them. Throws std::length_error if an element does not fit in buffer
+	template<typename F>
+	void dump(F&& write, char* buffer, std::size_t capacity) const;
+
+	//dump through a buffer of 64KiB
+	void dump(std::ostream& os) const {
+		char buffer[1 << 16];
+		dump([&os](const char* data, std::size_t size) {
+			os.write(data, size);
+		}, buffer, sizeof(buffer));
+	}
+
+	//formats each element through os, hence its flags apply, while dump is faster
+	friend
+	std::ostream& operator<<(std::ostream& os, const bst& tree) {
+		os << "bst(" << tree.size() << ") {";
+		for (const auto& p : tree) {
+			os << "(" << p.first << ": " << p.second << "), ";
+		}
+
+		return os << "}";
+	}
+private:
+	using node_allocator = typename node_type::node_allocator;
+	using node_traits = typename node_type::node_traits;
+	using node_pointer = typename node_type::pointer;
+
+	//the nodes of a stateful allocator are only destroyed, never given back one by one (see node::deleter)
+	static_assert(node_traits::is_always_equal::value || releases_in_bulk<node_allocator>::value,
+		"stateful allocators must release their memory in bulk, through release()");
+
+	std::size_t _size = 0;
+	Comparator comparator;
+	//declared before root, so that nodes are destroyed first
+	node_allocator alloc;
+	typename node_type::free_list recycled;
+	typename node_type::pointer root;
+	//the rightmost node, kept so that appending (e.g. hinted insertions at end()) does not walk the whole right spine
+	node_type* rightmost = nullptr;
+
+	//the searches take a key_type, or any type the comparator accepts if it is transparent
+	template<typename T>
+	std::pair<node_type*, KeyLocation> find_parent_candidate(node_type* root, const T& key) const;
+
+	template<typename T>
+	node_type* _find(const T& key) const;
+
+	//lower bound, or upper bound when upper is true
+	template<typename T>
+	node_type* _bound(const T& key, bool upper) const;
+
+	template<typename T>
+	std::pair<node_type*, node_type*> _equal_range(const T& key) const;
+
+	template<typename T>
+	std::size_t _rank(const T& key) const;
+
+	template<typename T>
+	std::size_t _erase_key(const T& key);
+
+	node_type* _nth(std::size_t k) const noexcept;
+
+	//position of n in sorted order, size() for null (end)
+	std::size_t _index(const node_type* n) const noexcept;
+
+	template<typename T, typename U>
+	std::pair<node_type*, node_type*> _range(const T& lo, const U& hi) const {
+		if (!comparator(lo, hi)) {
+			return std::make_pair(nullptr, nullptr);
+		}
+
+		return std::make_pair(_bound(lo, false), _bound(hi, false));
+	}
+
+	template<typename iterator_type, typename ForwardIt, typename OutputIt>
+	OutputIt _find_many(ForwardIt first, ForwardIt last, OutputIt out) const;
+
+	//the lowest ancestor of finger (a node visited by the search of a key not greater than key, or not smaller
+	//when after is false) whose subtree can contain key
+	node_type* climb_from_finger(node_type* finger, const key_type& key, bool after = true) const;
 
 	template<typename O>
 	std::pair<iterator, bool> _insert(O&& x);
 
-	template<typename O>
-	value_type& _square_brackets(O&& key) {
-		return _insert(pair_type{std::forward<O>(key), {}}).first->second;
+	template<typename O>
+	iterator _insert_hint(const_iterator hint, O&& x);
+
+	template<typename O, typename... Types>
+	std::pair<iterator, bool> _try_emplace(O&& key, Types&&...args);
+
+	//links a node as the given child of parent, which must be empty: args are either a node already created,
+	//or the arguments to create it
+	template<typename... Types>
+	node_type* _attach(node_type* parent, KeyLocation location, Types&&... args);
+
+	//the insertion functions accept either a pair or a node already holding it
+	static const key_type& key_of(const pair_type& x) noexcept {
+		return x.first;
+	}
+
+	static const key_type& key_of(const node_pointer& n) noexcept {
+		return n->data.first;
+	}
+
+	node_pointer make_node(node_type* parent, node_pointer&& n) noexcept {
+		n->set_parent(parent);
+		return std::move(n);
+	}
+
+	template<typename... Types>
+	node_pointer make_node(node_type* parent, Types&&... args) {
+		return recycled.create(alloc, parent, std::forward<Types>(args)...);
+	}
+
+	iterator _erase(node_type* n) noexcept;
+
+	//unlinks n and returns it: when n has two children, its successor is relinked in its place, so that
+	//no other node changes position in the sequence
+	node_pointer _unlink(node_type* n) noexcept;
+
+	//the value is default constructed in place only if key is missing
+	template<typename O>
+	value_type& _square_brackets(O&& key) {
+		return _try_emplace(std::forward<O>(key)).first->second;
+	}
+
+	//right rotations until no node has a left child, which leave the nodes in order along the right links (the vine)
+	static node_pointer to_vine(node_pointer& root) noexcept;
+
+	static node_pointer pop_front(node_pointer& vine) noexcept {
+		auto n = std::move(vine);
+		vine = std::move(n->right);
+		return n;
+	}
+
+	//takes the vine of size nodes as the content of the tree
+	void assign_vine(node_pointer& vine, std::size_t size) noexcept;
+
+	//keeps the elements whose key is present in other, or missing if present is false
+	void _filter(const bst& other, bool present);
+
+	//builds a tree of minimal height taking the first size nodes of the vine (a list linked through right)
+	static node_pointer build_balanced(node_pointer& vine, std::size_t size, std::size_t depth, std::size_t height) noexcept;
+
+	//the same, taking the nodes from an array listing them in order, and building the left subtrees by new threads
+	static node_pointer build_balanced(node_type* const* nodes, std::size_t size, std::size_t depth, std::size_t height,
+		std::size_t threads) noexcept;
+
+	std::size_t parallel_threads(std::size_t threads) const noexcept {
+		return std::min(threads, _size / parallel_threshold);
+	}
+
+	//calls visit(n, depth) on each node n, in order, keeping track of the depth along the way
+	template<typename F>
+	void visit_depths(F visit) const;
+
+	static std::size_t minimal_height(std::size_t size) noexcept {
+		std::size_t height = 0;
+		for (; size; size >>= 1) {
+			++height;
+		}
+
+		return height;
+	}
+};
+
+template<typename K, typename V, typename C, typename B, typename A>
+void bst<K, V, C, B, A>::clear() noexcept {
+	recycled.release();
+	if constexpr (releases_in_bulk<node_allocator>::value && std::is_trivially_destructible<pair_type>::value) {
+		//nothing to destroy: the nodes are dropped and their memory released at once
+		root.release();
+		alloc.release();
+		rightmost = nullptr;
+		_size = 0;
+		return;
 	}
 
-	using veciter = typename std::vector<pair_type>::iterator;
-	void move_balanced(std::vector<pair_type>& vec, veciter b, veciter e);
-};
+	node_type::clear(root);
+	rightmost = nullptr;
+	_size = 0;
+	if constexpr (releases_in_bulk<node_allocator>::value) {
+		alloc.release();
+	}
+}
 
-template<typename K, typename V, typename C>
-void bst<K, V, C>::clear() noexcept {
-	//the recursive deletion of nodes can result in stack overflow in degenerate cases
-	if (root) {
-		auto current = root->leftmost();
-		while (current) {
-			if (current->right) {
-				current = current->right->leftmost();
-			} else if (current->parent) {
-				while (current->parent && current == current->parent->right.get()) {
-					current->clear_children();
-					current = current->parent;
+template<typename K, typename V, typename C, typename B, typename A>
+typename bst<K, V, C, B, A>::iterator bst<K, V, C, B, A>::erase(const_iterator first, const_iterator last) noexcept {
+	while (first != last) {
+		first = _erase(first.current);
+	}
+
+	return iterator{last.current, root};
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename T>
+std::size_t bst<K, V, C, B, A>::_erase_key(const T& key) {
+	auto n = _find(key);
+	if (!n) {
+		return 0;
+	}
+
+	_erase(n);
+	return 1;
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+typename bst<K, V, C, B, A>::iterator bst<K, V, C, B, A>::_erase(node_type* n) noexcept {
+	assert(n);
+	auto next = iterator{n, root};
+	++next;
+	recycled.push(_unlink(n));
+	--_size;
+
+	return next;
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+typename bst<K, V, C, B, A>::node_pointer bst<K, V, C, B, A>::_unlink(node_type* n) noexcept {
+	auto& owner = node_type::owner(n, root);
+	if (n == rightmost) {
+		//the rightmost node has no right child
+		rightmost = n->left ? n->left->rightmost() : n->parent();
+	}
+	//the position that loses a node, as needed by the balancing policy
+	node_type* parent;
+	bool left;
+	unsigned tag;
+	node_pointer replacement;
+	if (!n->left || !n->right) {
+		parent = n->parent();
+		left = parent && n == parent->left.get();
+		tag = n->tag();
+		replacement = std::move(n->left ? n->left : n->right);
+		if (replacement) {
+			replacement->set_parent(parent);
+		}
+	} else {
+		//the successor has no left child: it leaves its own position, taking the one (and the tag) of n
+		auto successor = n->right->leftmost();
+		tag = successor->tag();
+		if (successor == n->right.get()) {
+			parent = successor;
+			left = false;
+			replacement = std::move(n->right);
+		} else {
+			parent = successor->parent();
+			left = true;
+			replacement = std::move(parent->left);
+			parent->left = std::move(successor->right);
+			if (parent->left) {
+				parent->left->set_parent(parent);
+			}
+			successor->right = std::move(n->right);
+			successor->right->set_parent(successor);
+		}
+		successor->left = std::move(n->left);
+		successor->left->set_parent(successor);
+		successor->set_parent(n->parent());
+		successor->set_tag(n->tag());
+		if constexpr (counts_subtrees<B>::value) {
+			successor->set_count(node_type::count(n));
+		}
+	}
+
+	auto unlinked = std::move(owner);
+	owner = std::move(replacement);
+	if constexpr (counts_subtrees<B>::value) {
+		for (auto p = parent; p; p = p->parent()) {
+			p->set_count(node_type::count(p) - 1);
+		}
+	}
+	B::after_erase(parent, left, tag, root);
+
+	return unlinked;
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+typename bst<K, V, C, B, A>::node_pointer bst<K, V, C, B, A>::to_vine(node_pointer& root) noexcept {
+	auto owner = &root;
+	while (*owner) {
+		if ((*owner)->left) {
+			node_type::rotate_right(*owner);
+		} else {
+			owner = &(*owner)->right;
+		}
+	}
+
+	return std::move(root);
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+void bst<K, V, C, B, A>::assign_vine(node_pointer& vine, std::size_t size) noexcept {
+	assert(!root);
+	root = build_balanced(vine, size, 1, minimal_height(size));
+	assert(!vine);
+	_size = size;
+	rightmost = root ? root->rightmost() : nullptr;
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+void bst<K, V, C, B, A>::balance() noexcept {
+	auto vine = to_vine(root);
+	assign_vine(vine, _size);
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+void bst<K, V, C, B, A>::merge(bst& other) {
+	if (&other == this) {
+		return;
+	}
+
+	//the elements are taken from the fronts of the vines, so that the merged one and the left over one
+	//precede both fronts, and can be joined to the rest of each vine should the comparator throw
+	const bool steal = alloc == other.alloc;
+	auto first = to_vine(root);
+	auto second = to_vine(other.root);
+	node_pointer merged{}, left_over{};
+	auto merged_tail = &merged, left_over_tail = &left_over;
+	std::size_t merged_size = 0, first_size = _size, left_over_size = 0, second_size = other._size;
+	try {
+		while (second) {
+			if (first && !comparator(second->data.first, first->data.first)) {
+				if (comparator(first->data.first, second->data.first)) {
+					*merged_tail = pop_front(first);
+					--first_size;
+				} else {
+					*left_over_tail = pop_front(second);
+					left_over_tail = &(*left_over_tail)->right;
+					--second_size;
+					++left_over_size;
+					continue;
 				}
+			} else if (steal) {
+				*merged_tail = pop_front(second);
+				--second_size;
+			} else {
+				*merged_tail = make_node(nullptr, std::move(second->data));
+				other.recycled.push(pop_front(second));
+				--second_size;
+			}
+			merged_tail = &(*merged_tail)->right;
+			++merged_size;
+		}
+	} catch (...) {
+		*merged_tail = std::move(first);
+		assign_vine(merged, merged_size + first_size);
+		*left_over_tail = std::move(second);
+		other.assign_vine(left_over, left_over_size + second_size);
+		throw;
+	}
 
-				current->clear_children();
-				current = current->parent;
+	*merged_tail = std::move(first);
+	assign_vine(merged, merged_size + first_size);
+	other.assign_vine(left_over, left_over_size);
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+void bst<K, V, C, B, A>::union_with(const bst& other) {
+	if (&other == this) {
+		return;
+	}
+
+	auto first = to_vine(root);
+	node_pointer merged{};
+	auto tail = &merged;
+	std::size_t merged_size = 0, first_size = _size;
+	try {
+		for (const auto& x : other) {
+			while (first && comparator(first->data.first, x.first)) {
+				*tail = pop_front(first);
+				tail = &(*tail)->right;
+				--first_size;
+				++merged_size;
+			}
+			if (!first || comparator(x.first, first->data.first)) {
+				*tail = make_node(nullptr, x);
+				tail = &(*tail)->right;
+				++merged_size;
+			}
+		}
+	} catch (...) {
+		*tail = std::move(first);
+		assign_vine(merged, merged_size + first_size);
+		throw;
+	}
+
+	*tail = std::move(first);
+	assign_vine(merged, merged_size + first_size);
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+void bst<K, V, C, B, A>::intersect_with(const bst& other) {
+	if (&other != this) {
+		_filter(other, true);
+	}
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+void bst<K, V, C, B, A>::difference(const bst& other) {
+	if (&other == this) {
+		clear();
+		return;
+	}
+
+	_filter(other, false);
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+void bst<K, V, C, B, A>::_filter(const bst& other, bool present) {
+	auto first = to_vine(root);
+	node_pointer kept{};
+	auto tail = &kept;
+	std::size_t kept_size = 0, first_size = _size;
+	auto x = other.begin();
+	try {
+		while (first) {
+			while (x != other.end() && comparator(x->first, first->data.first)) {
+				++x;
+			}
+			auto found = x != other.end() && !comparator(first->data.first, x->first);
+			--first_size;
+			if (found == present) {
+				*tail = pop_front(first);
+				tail = &(*tail)->right;
+				++kept_size;
 			} else {
-				current->clear_children();
-				current = nullptr;
+				recycled.push(pop_front(first));
 			}
 		}
+	} catch (...) {
+		*tail = std::move(first);
+		assign_vine(kept, kept_size + first_size);
+		throw;
 	}
 
-	root.reset();
-	_size = 0;
+	assign_vine(kept, kept_size);
 }
 
-template<typename K, typename V, typename C>
-void bst<K, V, C>::balance() {
-	std::vector<pair_type> vec{};
-	vec.reserve(_size);
+template<typename K, typename V, typename C, typename B, typename A>
+void bst<K, V, C, B, A>::balance(std::size_t threads) noexcept {
+	threads = parallel_threads(threads);
+	std::vector<node_type*> nodes{};
+	try {
+		if (threads > 1) {
+			nodes.reserve(_size);
+		}
+	} catch (...) {
+		threads = 1;
+	}
+	if (threads <= 1) {
+		balance();
+		return;
+	}
 
-	for (auto& p : *this) {
-		vec.emplace_back(std::move(p));
+	for (auto n = root->leftmost(); n; n = (++iterator{n, root}).current) {
+		nodes.push_back(n);
 	}
 
+	//each node is relinked by build_balanced, which releases its old children first
+	root.release();
+	root = build_balanced(nodes.data(), _size, 1, minimal_height(_size), threads);
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename InputIt>
+void bst<K, V, C, B, A>::assign_sorted(InputIt first, InputIt last) {
 	clear();
 
-	move_balanced(vec, vec.begin(), vec.end());
+	//the nodes are first linked in order through right, as balance() does
+	node_pointer vine{};
+	auto tail = &vine;
+	node_type* previous = nullptr;
+	try {
+		for (; first != last; ++first) {
+			*tail = node_type::create(alloc, previous, *first);
+			assert(!previous || comparator(previous->data.first, (*tail)->data.first));
+			previous = tail->get();
+			tail = &previous->right;
+			++_size;
+		}
+	} catch (...) {
+		//keep what has been loaded, as the vine is a valid (degenerate) tree
+		root = std::move(vine);
+		rightmost = previous;
+		balance();
+		throw;
+	}
+
+	root = build_balanced(vine, _size, 1, minimal_height(_size));
+	rightmost = previous;
+	assert(!vine);
 }
 
-template<typename K, typename V, typename C>
-std::size_t bst<K, V, C>::depth() const noexcept {
-	if (!root) {
-		return 0;
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename F>
+void bst<K, V, C, B, A>::dump(F&& write, char* buffer, std::size_t capacity) const {
+	const auto end = buffer + capacity;
+	auto current = buffer;
+	//appends the texts of xs, flushing the buffer first if they do not fit
+	auto append = [&](const auto&... xs) {
+		auto format = [end, &xs...](char* first) {
+			((first = first ? format_chars(first, end, xs) : first), ...);
+			return first;
+		};
+
+		auto next = format(current);
+		if (!next) {
+			write(static_cast<const char*>(buffer), static_cast<std::size_t>(current - buffer));
+			current = buffer;
+			next = format(current);
+			if (!next) {
+				throw std::length_error{"bst::dump buffer too small for an element"};
+			}
+		}
+		current = next;
+	};
+
+	append("bst(", _size, ") {");
+	for (const auto& p : *this) {
+		append("(", p.first, ": ", p.second, "), ");
 	}
+	append("}");
 
+	write(static_cast<const char*>(buffer), static_cast<std::size_t>(current - buffer));
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+std::size_t bst<K, V, C, B, A>::depth() const noexcept {
 	std::size_t depth = 0;
-	for (auto iter = cbegin(); iter != cend(); ++iter) {
-		depth = std::max(depth, iter.depth());
-	}
+	visit_depths([&depth](const node_type*, std::size_t d) {
+		depth = std::max(depth, d);
+	});
 
 	return depth;
 }
 
-template<typename K, typename V, typename C>
-std::pair<typename bst<K, V, C>::node_type*, KeyLocation> bst<K, V, C>::find_parent_candidate(bst<K, V, C>::node_type* root, const K& key) const {
+template<typename K, typename V, typename C, typename B, typename A>
+tree_shape bst<K, V, C, B, A>::shape_stats() const {
+	tree_shape shape{};
+	std::size_t total_depth = 0;
+	visit_depths([&shape, &total_depth](const node_type* n, std::size_t depth) {
+		if (shape.levels.size() < depth) {
+			shape.levels.resize(depth);
+		}
+		++shape.levels[depth - 1];
+		total_depth += depth;
+		shape.leaves += !n->left && !n->right;
+	});
+
+	shape.size = _size;
+	shape.max_depth = shape.levels.size();
+	shape.average_depth = _size ? double(total_depth) / _size : 0;
+
+	return shape;
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename F>
+void bst<K, V, C, B, A>::visit_depths(F visit) const {
+	//each edge is walked once down and once up, instead of climbing to the root from every node
+	auto current = root ? root->leftmost() : nullptr;
+	auto depth = current ? current->depth() : 0;
+	while (current) {
+		visit(static_cast<const node_type*>(current), depth);
+		if (current->right) {
+			current = current->right.get();
+			++depth;
+			for (; current->left; ++depth) {
+				current = current->left.get();
+			}
+		} else {
+			while (current->parent() && current == current->parent()->right.get()) {
+				current = current->parent();
+				--depth;
+			}
+			current = current->parent();
+			--depth;
+		}
+	}
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename T>
+std::pair<typename bst<K, V, C, B, A>::node_type*, KeyLocation> bst<K, V, C, B, A>::find_parent_candidate(bst<K, V, C, B, A>::node_type* root, const T& key) const {
 	assert(root);
 	auto current = root;
-	std::size_t i = 0;
-	while (i != _size) {
+	if constexpr (prefetches_children<B>::value) {
+		static constexpr node_pointer node_type::* children[2] = {&node_type::left, &node_type::right};
+		node_type* candidate = nullptr;
+		node_type* parent;
+		bool right;
+		do {
+#if defined(__GNUC__)
+			__builtin_prefetch(current->left.get());
+			__builtin_prefetch(current->right.get());
+#endif
+			parent = current;
+			right = comparator(current->data.first, key);
+			candidate = right ? candidate : current;
+			current = (current->*children[right]).get();
+		} while (current);
+
+		if (candidate && !comparator(key, candidate->data.first)) {
+			return std::make_pair(candidate, KeyLocation::PARENT);
+		}
+		return std::make_pair(parent, right ? KeyLocation::RIGHT : KeyLocation::LEFT);
+	} else if constexpr (compares_three_way<C, T, K>::value) {
+		for (;;) {
+			auto c = comparator.compare(key, current->data.first);
+			if (c < 0) {
+				if (!current->left) {
+					return std::make_pair(current, KeyLocation::LEFT);
+				}
+				current = current->left.get();
+			} else if (c > 0) {
+				if (!current->right) {
+					return std::make_pair(current, KeyLocation::RIGHT);
+				}
+				current = current->right.get();
+			} else {
+				return std::make_pair(current, KeyLocation::PARENT);
+			}
+		}
+	}
+
+	for (;;) {
 		if (comparator(key, current->data.first)) {
 			if (!current->left) {
 				return std::make_pair(current, KeyLocation::LEFT);
@@ -399,15 +2297,12 @@ std::pair<typename bst<K, V, C>::node_type*, KeyLocation> bst<K, V, C>::find_par
 		} else {
 			return std::make_pair(current, KeyLocation::PARENT);
 		}
-
-		++i;
 	}
-
-	return std::make_pair(nullptr, KeyLocation::PARENT);
 }
 
-template<typename K, typename V, typename C>
-typename bst<K, V, C>::node_type* bst<K, V, C>::_find(const K& key) const {
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename T>
+typename bst<K, V, C, B, A>::node_type* bst<K, V, C, B, A>::_find(const T& key) const {
 	if (root) {
 		auto search = find_parent_candidate(root.get(), key);
 		assert(search.first);
@@ -419,50 +2314,376 @@ typename bst<K, V, C>::node_type* bst<K, V, C>::_find(const K& key) const {
 	return nullptr;
 }
 
-template<typename K, typename V, typename C>
-template<typename O>
-std::pair<typename bst<K, V, C>::iterator, bool> bst<K, V, C>::_insert(O&& x) {
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename T>
+typename bst<K, V, C, B, A>::node_type* bst<K, V, C, B, A>::_bound(const T& key, bool upper) const {
 	if (!root) {
-		root.reset(new node_type{nullptr, std::forward<O>(x)});
-		++_size;
+		return nullptr;
+	}
+
+	auto searched = find_parent_candidate(root.get(), key);
+	auto n = searched.first;
+	assert(n);
+	switch (searched.second) {
+		case KeyLocation::PARENT:
+			return upper ? (++iterator{n, root}).current : n;
+		case KeyLocation::LEFT:
+			//key would be the left child of n, hence n is the first greater key
+			return n;
+		default:
+			//key would be the right child of n: the first greater key is the successor of n, which has no right child
+			return n->first_right_ancestor();
+	}
+}
 
-		return std::make_pair(iterator{root.get()}, true);
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename T>
+std::pair<typename bst<K, V, C, B, A>::node_type*, typename bst<K, V, C, B, A>::node_type*> bst<K, V, C, B, A>::_equal_range(const T& key) const {
+	if (!root) {
+		return std::make_pair(nullptr, nullptr);
 	}
 
-	auto searched = find_parent_candidate(root.get(), x.first);
-	auto parent = searched.first;
-	assert(parent);
+	auto searched = find_parent_candidate(root.get(), key);
+	auto n = searched.first;
+	assert(n);
 	switch (searched.second) {
 		case KeyLocation::PARENT:
-			return std::make_pair(iterator{parent}, false);
+			return std::make_pair(n, (++iterator{n, root}).current);
 		case KeyLocation::LEFT:
-			parent->left.reset(new node_type{parent, std::forward<O>(x)});
-			++_size;
+			return std::make_pair(n, n);
+		default:
+			n = n->first_right_ancestor();
+			return std::make_pair(n, n);
+	}
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+typename bst<K, V, C, B, A>::node_type* bst<K, V, C, B, A>::_nth(std::size_t k) const noexcept {
+	auto current = root.get();
+	while (current) {
+		auto left = node_type::count(current->left.get());
+		if (k < left) {
+			current = current->left.get();
+		} else if (k == left) {
+			return current;
+		} else {
+			k -= left + 1;
+			current = current->right.get();
+		}
+	}
+
+	return nullptr;
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename T>
+std::size_t bst<K, V, C, B, A>::_rank(const T& key) const {
+	std::size_t rank = 0;
+	auto current = root.get();
+	while (current) {
+		if (comparator(current->data.first, key)) {
+			rank += node_type::count(current->left.get()) + 1;
+			current = current->right.get();
+		} else {
+			current = current->left.get();
+		}
+	}
+
+	return rank;
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+std::size_t bst<K, V, C, B, A>::_index(const node_type* n) const noexcept {
+	if (!n) {
+		return node_type::count(root.get());
+	}
+
+	//the nodes before n are in its left subtree, and in the left subtrees of the ancestors it is on the right of
+	auto index = node_type::count(n->left.get());
+	for (auto parent = n->parent(); parent; n = parent, parent = parent->parent()) {
+		if (n == parent->right.get()) {
+			index += node_type::count(parent->left.get()) + 1;
+		}
+	}
+
+	return index;
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename iterator_type, typename ForwardIt, typename OutputIt>
+OutputIt bst<K, V, C, B, A>::_find_many(ForwardIt first, ForwardIt last, OutputIt out) const {
+	if (!root) {
+		for (; first != last; ++first) {
+			*out++ = iterator_type{nullptr, root};
+		}
+
+		return out;
+	}
+
+	if (std::is_sorted(first, last, [this](const K& lhs, const K& rhs) { return comparator(lhs, rhs); })) {
+		auto finger = root.get();
+		for (; first != last; ++first) {
+			auto search = find_parent_candidate(climb_from_finger(finger, *first), *first);
+			assert(search.first);
+			finger = search.first;
+			*out++ = iterator_type{search.second == KeyLocation::PARENT ? search.first : nullptr, root};
+		}
+
+		return out;
+	}
+
+	//each round advances every pending search of the group by one level, so that their cache misses overlap
+	constexpr std::size_t group_size = 8;
+	const K* keys[group_size];
+	node_type* current[group_size];
+	bool found[group_size];
+	while (first != last) {
+		std::size_t count = 0;
+		for (; count != group_size && first != last; ++count, ++first) {
+			keys[count] = &*first;
+			current[count] = root.get();
+			found[count] = false;
+		}
+
+		for (auto pending = count; pending;) {
+			pending = 0;
+			for (std::size_t i = 0; i != count; ++i) {
+				auto n = current[i];
+				if (!n || found[i]) {
+					continue;
+				}
+
+				if (comparator(*keys[i], n->data.first)) {
+					n = n->left.get();
+				} else if (comparator(n->data.first, *keys[i])) {
+					n = n->right.get();
+				} else {
+					found[i] = true;
+					continue;
+				}
+
+				current[i] = n;
+				if (n) {
+#if defined(__GNUC__)
+					__builtin_prefetch(n);
+#endif
+					++pending;
+				}
+			}
+		}
+
+		for (std::size_t i = 0; i != count; ++i) {
+			*out++ = iterator_type{found[i] ? current[i] : nullptr, root};
+		}
+	}
+
+	return out;
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+typename bst<K, V, C, B, A>::node_type* bst<K, V, C, B, A>::climb_from_finger(node_type* finger, const K& key, bool after) const {
+	//the subtree of a right child has the same upper bound as its parent's, so only left children need a comparison
+	//(and vice versa when climbing towards smaller keys)
+	auto current = finger;
+	while (auto parent = current->parent()) {
+		if (after ? current == parent->left.get() && comparator(key, parent->data.first)
+			: current == parent->right.get() && comparator(parent->data.first, key)) {
+			break;
+		}
+		current = parent;
+	}
+
+	return current;
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename O>
+std::pair<typename bst<K, V, C, B, A>::iterator, bool> bst<K, V, C, B, A>::_insert(O&& x) {
+	if (!root) {
+		return std::make_pair(iterator{_attach(nullptr, KeyLocation::PARENT, std::forward<O>(x)), root}, true);
+	}
+
+	auto searched = find_parent_candidate(root.get(), key_of(x));
+	assert(searched.first);
+	if (searched.second == KeyLocation::PARENT) {
+		return std::make_pair(iterator{searched.first, root}, false);
+	}
+
+	return std::make_pair(iterator{_attach(searched.first, searched.second, std::forward<O>(x)), root}, true);
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename O, typename... Types>
+std::pair<typename bst<K, V, C, B, A>::iterator, bool> bst<K, V, C, B, A>::_try_emplace(O&& key, Types&&...args) {
+	auto searched = std::make_pair(static_cast<node_type*>(nullptr), KeyLocation::PARENT);
+	if (root) {
+		searched = find_parent_candidate(root.get(), key);
+		assert(searched.first);
+		if (searched.second == KeyLocation::PARENT) {
+			return std::make_pair(iterator{searched.first, root}, false);
+		}
+	}
+
+	return std::make_pair(iterator{_attach(searched.first, searched.second, std::in_place, std::piecewise_construct,
+		std::forward_as_tuple(std::forward<O>(key)), std::forward_as_tuple(std::forward<Types>(args)...)), root}, true);
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename O>
+typename bst<K, V, C, B, A>::iterator bst<K, V, C, B, A>::_insert_hint(const_iterator hint, O&& x) {
+	if (!root) {
+		return _insert(std::forward<O>(x)).first;
+	}
+
+	const auto& key = key_of(x);
+	auto h = hint.current;
+	auto after = true;
+	if (!h) {
+		//after the last element
+		h = rightmost;
+		after = false;
+		if (comparator(h->data.first, key)) {
+			return iterator{_attach(h, KeyLocation::RIGHT, std::forward<O>(x)), root};
+		}
+	} else if (comparator(key, h->data.first)) {
+		after = false;
+		//between the predecessor of h and h: the free slot is either h's left or the predecessor's right
+		auto previous = h->left ? h->left->rightmost() : h->first_left_ancestor();
+		if (!previous || comparator(previous->data.first, key)) {
+			if (!h->left) {
+				return iterator{_attach(h, KeyLocation::LEFT, std::forward<O>(x)), root};
+			}
+			return iterator{_attach(previous, KeyLocation::RIGHT, std::forward<O>(x)), root};
+		}
+	} else if (comparator(h->data.first, key)) {
+		//between h and its successor: the free slot is either h's right or the successor's left
+		auto next = h->right ? h->right->leftmost() : h->first_right_ancestor();
+		if (!next || comparator(key, next->data.first)) {
+			if (!h->right) {
+				return iterator{_attach(h, KeyLocation::RIGHT, std::forward<O>(x)), root};
+			}
+			return iterator{_attach(next, KeyLocation::LEFT, std::forward<O>(x)), root};
+		}
+	} else {
+		return iterator{h, root};
+	}
+
+	auto searched = find_parent_candidate(climb_from_finger(h, key, after), key);
+	assert(searched.first);
+	if (searched.second == KeyLocation::PARENT) {
+		return iterator{searched.first, root};
+	}
+
+	return iterator{_attach(searched.first, searched.second, std::forward<O>(x)), root};
+}
 
-			return std::make_pair(iterator{parent->left.get()}, true);
+template<typename K, typename V, typename C, typename B, typename A>
+template<typename... Types>
+typename bst<K, V, C, B, A>::node_type* bst<K, V, C, B, A>::_attach(node_type* parent, KeyLocation location, Types&&... args) {
+	node_type* inserted = nullptr;
+	switch (location) {
+		case KeyLocation::PARENT:
+			assert(!root && !parent);
+			root = make_node(nullptr, std::forward<Types>(args)...);
+			inserted = root.get();
+			rightmost = inserted;
+			break;
+		case KeyLocation::LEFT:
+			assert(!parent->left);
+			parent->left = make_node(parent, std::forward<Types>(args)...);
+			inserted = parent->left.get();
+			break;
 		case KeyLocation::RIGHT:
-			parent->right.reset(new node_type{parent, std::forward<O>(x)});
-			++_size;
+			assert(!parent->right);
+			parent->right = make_node(parent, std::forward<Types>(args)...);
+			inserted = parent->right.get();
+			if (parent == rightmost) {
+				rightmost = inserted;
+			}
+			break;
+	}
 
-			return std::make_pair(iterator{parent->right.get()}, true);
-		default:
-			assert(false);
+	++_size;
+	if constexpr (counts_subtrees<B>::value) {
+		for (auto n = parent; n; n = n->parent()) {
+			n->set_count(node_type::count(n) + 1);
+		}
 	}
+	//rotations relink nodes without moving them, so inserted stays valid
+	B::after_insert(inserted, root);
 
-	return std::make_pair(end(), false);
+	return inserted;
 }
 
-template<typename K, typename V, typename C>
-void bst<K, V, C>::move_balanced(std::vector<bst<K, V, C>::pair_type>& vec, bst<K, V, C>::veciter b, bst<K, V, C>::veciter e) {
-	if (b == e) {
-		return;
+template<typename K, typename V, typename C, typename B, typename A>
+typename bst<K, V, C, B, A>::node_pointer bst<K, V, C, B, A>::build_balanced(node_pointer& vine, std::size_t size, std::size_t depth, std::size_t height) noexcept {
+	if (!size) {
+		return node_pointer{};
+	}
+
+	//the recursion is only as deep as the resulting tree
+	auto left_size = (size - 1) / 2;
+	auto right_size = size - 1 - left_size;
+	auto left = build_balanced(vine, left_size, depth + 1, height);
+
+	auto current = std::move(vine);
+	vine = std::move(current->right);
+	current->set_parent(nullptr);
+
+	current->left = std::move(left);
+	if (current->left) {
+		current->left->set_parent(current.get());
+	}
+	current->right = build_balanced(vine, right_size, depth + 1, height);
+	if (current->right) {
+		current->right->set_parent(current.get());
+	}
+	current->set_count(size);
+
+	B::after_rebuild(current.get(), depth, height, minimal_height(left_size), minimal_height(right_size));
+
+	return current;
+}
+
+template<typename K, typename V, typename C, typename B, typename A>
+typename bst<K, V, C, B, A>::node_pointer bst<K, V, C, B, A>::build_balanced(node_type* const* nodes, std::size_t size, std::size_t depth,
+	std::size_t height, std::size_t threads) noexcept {
+	if (!size) {
+		return node_pointer{};
+	}
+
+	auto left_size = (size - 1) / 2;
+	auto right_size = size - 1 - left_size;
+	std::future<node_pointer> left_future{};
+	if (threads > 1) {
+		try {
+			left_future = std::async(std::launch::async, [=]() {
+				return build_balanced(nodes, left_size, depth + 1, height, threads / 2);
+			});
+		} catch (...) {
+			//no thread available: the left subtree is built below, by this one
+			threads = 1;
+		}
+	}
+
+	node_pointer current{nodes[left_size]};
+	current->left.release();
+	current->right.release();
+	current->set_parent(nullptr);
+
+	current->right = build_balanced(nodes + left_size + 1, right_size, depth + 1, height, threads - threads / 2);
+	if (current->right) {
+		current->right->set_parent(current.get());
 	}
+	current->left = threads > 1 ? left_future.get() : build_balanced(nodes, left_size, depth + 1, height, 1);
+	if (current->left) {
+		current->left->set_parent(current.get());
+	}
+	current->set_count(size);
 
-	auto mid = b + (std::distance(b, e) / 2);
-	_insert(std::move(*mid));
+	B::after_rebuild(current.get(), depth, height, minimal_height(left_size), minimal_height(right_size));
 
-	move_balanced(vec, b, mid);
-	move_balanced(vec, mid + 1, e);
+	return current;
 }
 
 #endif
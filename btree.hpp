@@ -0,0 +1,610 @@
+#ifndef __BTREE_HPP__
+#define __BTREE_HPP__
+
+#include <iostream>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <memory>
+#include <new>
+#include <tuple>
+
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <cstdint>
+
+#include <cassert>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+//nodes of btree: inner nodes hold count keys and count + 1 children, where the keys of children[i + 1] are not smaller
+//than keys[i]; leaves hold the pairs, and are linked in order. Unused keys are zero, so that whole vectors can be loaded
+struct btree_node {
+};
+
+template<typename key_type, std::size_t capacity>
+struct btree_inner_node: btree_node {
+	std::size_t count = 0;
+	key_type keys[capacity] = {};
+	btree_node* children[capacity + 1] = {};
+};
+
+template<typename pair_type, std::size_t capacity>
+struct btree_leaf_node: btree_node {
+	std::size_t count = 0;
+	btree_leaf_node* previous = nullptr;
+	btree_leaf_node* next = nullptr;
+	//constructed only in [0, count)
+	alignas(pair_type) unsigned char storage[capacity * sizeof(pair_type)];
+
+	btree_leaf_node() = default;
+
+	btree_leaf_node(const btree_leaf_node&) = delete;
+	btree_leaf_node& operator=(const btree_leaf_node&) = delete;
+
+	~btree_leaf_node() {
+		for (std::size_t i = 0; i != count; ++i) {
+			pairs()[i].~pair_type();
+		}
+	}
+
+	pair_type* pairs() noexcept {
+		return std::launder(reinterpret_cast<pair_type*>(storage));
+	}
+
+	//moves the pairs in [first, count) one slot to the right
+	void shift_right(std::size_t first) noexcept {
+		for (auto i = count; i != first; --i) {
+			new (pairs() + i) pair_type{std::move(pairs()[i - 1])};
+			pairs()[i - 1].~pair_type();
+		}
+	}
+};
+
+//bidirectional iterator on the leaves
+template<typename leaf_type, typename ref_type>
+class btree_iterator {
+	template<typename, typename>
+	friend class btree_iterator;
+
+	template<typename, typename, typename, std::size_t>
+	friend class btree;
+
+	leaf_type* leaf;
+	std::size_t index;
+	//the end iterator (a null leaf) is decremented to the last pair of the tree
+	leaf_type* const* last;
+public:
+	using value_type = ref_type;
+	using reference = value_type&;
+	using pointer = value_type*;
+	using difference_type = std::ptrdiff_t;
+	using iterator_category = std::bidirectional_iterator_tag;
+
+	btree_iterator(leaf_type* leaf, std::size_t index, leaf_type* const& last) noexcept: leaf{leaf}, index{index}, last{&last} {
+	}
+
+	//iterator to const_iterator conversion
+	template<typename other_ref, typename = std::enable_if_t<std::is_convertible<other_ref*, ref_type*>::value>>
+	btree_iterator(const btree_iterator<leaf_type, other_ref>& other) noexcept: leaf{other.leaf}, index{other.index}, last{other.last} {
+	}
+
+	reference operator*() const noexcept {
+		return leaf->pairs()[index];
+	}
+
+	pointer operator->() const noexcept {
+		return &**this;
+	}
+
+	btree_iterator& operator++() noexcept {
+		if (++index == leaf->count) {
+			leaf = leaf->next;
+			index = 0;
+		}
+
+		return *this;
+	}
+
+	btree_iterator operator++(int) noexcept {
+		auto tmp(*this);
+		++(*this);
+		return tmp;
+	}
+
+	btree_iterator& operator--() noexcept {
+		if (!leaf) {
+			leaf = *last;
+			index = leaf->count;
+		} else if (!index) {
+			leaf = leaf->previous;
+			index = leaf->count;
+		}
+		--index;
+
+		return *this;
+	}
+
+	btree_iterator operator--(int) noexcept {
+		auto tmp(*this);
+		--(*this);
+		return tmp;
+	}
+
+	friend
+	bool operator==(const btree_iterator& lhs, const btree_iterator& rhs) noexcept {
+		return lhs.leaf == rhs.leaf && lhs.index == rhs.index;
+	}
+
+	friend
+	bool operator!=(const btree_iterator& lhs, const btree_iterator& rhs) noexcept {
+		return !(lhs == rhs);
+	}
+};
+
+//B+-tree with the interface of bst for lookups and insertions (no erasure): each node holds up to node_size keys,
+//so that a search visits log(n) / log(node_size) nodes instead of log(n), each read in a few cache lines.
+//Inner nodes keep their keys in an array of their own: for 32 and 64 bits integer keys compared by std::less,
+//it is searched a vector at a time when the target supports it (SSE2 and SSE4.2, or AVX2, e.g. with -march=native),
+//otherwise key by key, without branches. Pairs move within leaves, which copies their const keys: keys must be
+//nothrow copy constructible, and values nothrow move constructible
+template<typename key_type, typename value_type, typename Comparator = std::less<key_type>, std::size_t node_size = 32>
+class btree {
+public:
+	using pair_type = std::pair<const key_type, value_type>;
+
+	static_assert(node_size >= 8 && node_size <= 64 && node_size % 8 == 0, "nodes hold a multiple of 8 keys, up to 64");
+	static_assert(std::is_nothrow_move_constructible<pair_type>::value, "pairs (keys copied, values moved) are moved within leaves while inserting");
+
+	using inner_node = btree_inner_node<key_type, node_size>;
+	using leaf_node = btree_leaf_node<pair_type, node_size>;
+	using iterator = btree_iterator<leaf_node, pair_type>;
+	using const_iterator = btree_iterator<leaf_node, const pair_type>;
+
+	btree() = default;
+
+	//the pairs are appended in order, which fills the leaves to the brim
+	btree(const btree& other): comparator{other.comparator} {
+		try {
+			for (const auto& p : other) {
+				_try_emplace(p.first, p.second);
+			}
+		} catch (...) {
+			clear();
+			throw;
+		}
+	}
+
+	btree& operator=(const btree& other) {
+		auto tmp = btree{other};
+		return *this = std::move(tmp);
+	}
+
+	btree(btree&& other) noexcept: _size{other._size}, height{other.height}, root{other.root}, first{other.first}, last{other.last},
+		comparator{std::move(other.comparator)} {
+		other._size = 0;
+		other.height = 0;
+		other.root = nullptr;
+		other.first = other.last = nullptr;
+	}
+
+	btree& operator=(btree&& other) noexcept {
+		clear();
+		std::swap(_size, other._size);
+		std::swap(height, other.height);
+		std::swap(root, other.root);
+		std::swap(first, other.first);
+		std::swap(last, other.last);
+		comparator = std::move(other.comparator);
+
+		return *this;
+	}
+
+	~btree() noexcept {
+		clear();
+	}
+
+	Comparator key_comp() const {
+		return comparator;
+	}
+
+	std::size_t size() const noexcept {
+		return _size;
+	}
+
+	//number of levels, leaves included
+	std::size_t depth() const noexcept {
+		return height;
+	}
+
+	iterator begin() noexcept {
+		return iterator{first, 0, last};
+	}
+
+	const_iterator begin() const noexcept {
+		return const_iterator{first, 0, last};
+	}
+
+	iterator end() noexcept {
+		return iterator{nullptr, 0, last};
+	}
+
+	const_iterator end() const noexcept {
+		return const_iterator{nullptr, 0, last};
+	}
+
+	const_iterator cbegin() const noexcept {
+		return begin();
+	}
+
+	const_iterator cend() const noexcept {
+		return end();
+	}
+
+	iterator find(const key_type& key) {
+		auto position = _find(key);
+		return iterator{position.first, position.second, last};
+	}
+
+	const_iterator find(const key_type& key) const {
+		auto position = _find(key);
+		return const_iterator{position.first, position.second, last};
+	}
+
+	//first element whose key is not smaller than key
+	iterator lower_bound(const key_type& key) {
+		auto position = _lower_bound(key);
+		return iterator{position.first, position.second, last};
+	}
+
+	const_iterator lower_bound(const key_type& key) const {
+		auto position = _lower_bound(key);
+		return const_iterator{position.first, position.second, last};
+	}
+
+	std::pair<iterator, bool> insert(const pair_type& x) {
+		return _try_emplace(x.first, x.second);
+	}
+
+	std::pair<iterator, bool> insert(pair_type&& x) {
+		return _try_emplace(x.first, std::move(x.second));
+	}
+
+	//the pair is constructed first, to find its key
+	template<typename... Types>
+	std::pair<iterator, bool> emplace(Types&&... args) {
+		pair_type x(std::forward<Types>(args)...);
+		return _try_emplace(x.first, std::move(x.second));
+	}
+
+	//the value is constructed (from args) only when key is not already present
+	template<typename... Types>
+	std::pair<iterator, bool> try_emplace(const key_type& key, Types&&... args) {
+		return _try_emplace(key, std::forward<Types>(args)...);
+	}
+
+	value_type& operator[](const key_type& key) {
+		return _try_emplace(key).first->second;
+	}
+
+	void clear() noexcept {
+		if (root) {
+			destroy(root, height);
+		}
+		_size = 0;
+		height = 0;
+		root = nullptr;
+		first = last = nullptr;
+	}
+
+	friend
+	std::ostream& operator<<(std::ostream& os, const btree& tree) {
+		os << "btree(" << tree.size() << ") {";
+		for (const auto& p : tree) {
+			os << "(" << p.first << ": " << p.second << "), ";
+		}
+
+		return os << "}";
+	}
+private:
+	//the height of a tree of 2^64 pairs, with the minimal fanout (node_size / 2) below the root
+	static constexpr std::size_t max_height = 64;
+
+	std::size_t _size = 0;
+	//0 when empty, 1 when root is a leaf
+	std::size_t height = 0;
+	btree_node* root = nullptr;
+	leaf_node* first = nullptr;
+	leaf_node* last = nullptr;
+	Comparator comparator{};
+
+	static constexpr bool vector_search = std::is_integral<key_type>::value && !std::is_same<key_type, bool>::value
+		&& (sizeof(key_type) == 4 || sizeof(key_type) == 8)
+		&& (std::is_same<Comparator, std::less<key_type>>::value || std::is_same<Comparator, std::less<>>::value);
+
+	//index of the child of n whose subtree can contain key: the number of keys not greater than key
+	std::size_t child_index(const inner_node* n, const key_type& key) const noexcept;
+
+	//index of the first pair of n whose key is not smaller than key (n->count if none)
+	std::size_t pair_index(leaf_node* n, const key_type& key) const noexcept {
+		std::size_t index = 0;
+		for (std::size_t i = 0; i != n->count; ++i) {
+			index += comparator(n->pairs()[i].first, key);
+		}
+
+		return index;
+	}
+
+	//the leaf whose range contains key, recording the path from root (inner nodes and child indexes) if given
+	leaf_node* descend(const key_type& key, std::pair<inner_node*, std::size_t>* path = nullptr) const noexcept;
+
+	std::pair<leaf_node*, std::size_t> _find(const key_type& key) const noexcept;
+
+	std::pair<leaf_node*, std::size_t> _lower_bound(const key_type& key) const noexcept;
+
+	//appending after the last pair skips the searches
+	template<typename... Types>
+	std::pair<iterator, bool> _try_emplace(const key_type& key, Types&&... args);
+
+	//inserts x at index of leaf, splitting the full nodes from leaf up, as recorded in path
+	iterator insert_at(leaf_node* leaf, std::size_t index, pair_type&& x, std::pair<inner_node*, std::size_t>* path);
+
+	static void destroy(btree_node* n, std::size_t height) noexcept;
+};
+
+template<typename K, typename V, typename C, std::size_t N>
+std::size_t btree<K, V, C, N>::child_index(const inner_node* n, const K& key) const noexcept {
+	if constexpr (vector_search) {
+#if defined(__SSE2__)
+		//bit i is set when keys[i] is greater than key; signed comparisons, so unsigned keys are biased first
+		std::uint64_t greater = 0;
+		const auto keys = n->keys;
+		if constexpr (sizeof(K) == 8) {
+#if defined(__AVX2__) || defined(__SSE4_2__)
+			constexpr auto bias = std::is_signed<K>::value ? 0 : std::numeric_limits<std::int64_t>::min();
+#endif
+#if defined(__AVX2__)
+			const auto k = _mm256_set1_epi64x(static_cast<std::int64_t>(key) ^ bias);
+			for (std::size_t i = 0; i < n->count; i += 4) {
+				auto v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), _mm256_set1_epi64x(bias));
+				greater |= std::uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, k)))) << i;
+			}
+#elif defined(__SSE4_2__)
+			const auto k = _mm_set1_epi64x(static_cast<std::int64_t>(key) ^ bias);
+			for (std::size_t i = 0; i < n->count; i += 2) {
+				auto v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), _mm_set1_epi64x(bias));
+				greater |= std::uint64_t(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, k)))) << i;
+			}
+#else
+			//no 64 bits comparison before SSE4.2
+			for (std::size_t i = 0; i < n->count; ++i) {
+				greater |= std::uint64_t(key < keys[i]) << i;
+			}
+#endif
+		} else {
+			constexpr auto bias = std::is_signed<K>::value ? 0 : std::numeric_limits<std::int32_t>::min();
+#if defined(__AVX2__)
+			const auto k = _mm256_set1_epi32(static_cast<std::int32_t>(key) ^ bias);
+			for (std::size_t i = 0; i < n->count; i += 8) {
+				auto v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), _mm256_set1_epi32(bias));
+				greater |= std::uint64_t(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, k)))) << i;
+			}
+#else
+			const auto k = _mm_set1_epi32(static_cast<std::int32_t>(key) ^ bias);
+			for (std::size_t i = 0; i < n->count; i += 4) {
+				auto v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), _mm_set1_epi32(bias));
+				greater |= std::uint64_t(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, k)))) << i;
+			}
+#endif
+		}
+
+		//the lanes past count hold unused keys
+		greater &= n->count == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << n->count) - 1;
+		return n->count - __builtin_popcountll(greater);
+#endif
+	}
+
+	std::size_t index = 0;
+	for (std::size_t i = 0; i != n->count; ++i) {
+		index += !comparator(key, n->keys[i]);
+	}
+
+	return index;
+}
+
+template<typename K, typename V, typename C, std::size_t N>
+typename btree<K, V, C, N>::leaf_node* btree<K, V, C, N>::descend(const K& key, std::pair<inner_node*, std::size_t>* path) const noexcept {
+	auto current = root;
+	for (std::size_t level = 1; level < height; ++level) {
+		auto n = static_cast<inner_node*>(current);
+		auto index = child_index(n, key);
+		if (path) {
+			path[level - 1] = std::make_pair(n, index);
+		}
+		current = n->children[index];
+	}
+
+	return static_cast<leaf_node*>(current);
+}
+
+template<typename K, typename V, typename C, std::size_t N>
+std::pair<typename btree<K, V, C, N>::leaf_node*, std::size_t> btree<K, V, C, N>::_find(const K& key) const noexcept {
+	if (root) {
+		auto leaf = descend(key);
+		auto index = pair_index(leaf, key);
+		if (index != leaf->count && !comparator(key, leaf->pairs()[index].first)) {
+			return std::make_pair(leaf, index);
+		}
+	}
+
+	return std::make_pair(nullptr, 0);
+}
+
+template<typename K, typename V, typename C, std::size_t N>
+std::pair<typename btree<K, V, C, N>::leaf_node*, std::size_t> btree<K, V, C, N>::_lower_bound(const K& key) const noexcept {
+	if (root) {
+		auto leaf = descend(key);
+		auto index = pair_index(leaf, key);
+		if (index != leaf->count) {
+			return std::make_pair(leaf, index);
+		}
+		//all the keys of the leaf are smaller: the bound is the first pair of the next one
+		return std::make_pair(leaf->next, 0);
+	}
+
+	return std::make_pair(nullptr, 0);
+}
+
+template<typename K, typename V, typename C, std::size_t N>
+template<typename... Types>
+std::pair<typename btree<K, V, C, N>::iterator, bool> btree<K, V, C, N>::_try_emplace(const K& key, Types&&... args) {
+	std::pair<inner_node*, std::size_t> path[max_height];
+	if (!root) {
+		auto leaf = new leaf_node{};
+		new (leaf->pairs()) pair_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Types>(args)...));
+		leaf->count = 1;
+		root = first = last = leaf;
+		height = 1;
+		_size = 1;
+		return std::make_pair(begin(), true);
+	}
+
+	//appending after the last pair: the path is the rightmost one
+	if (comparator(last->pairs()[last->count - 1].first, key)) {
+		auto current = root;
+		for (std::size_t level = 1; level < height; ++level) {
+			auto n = static_cast<inner_node*>(current);
+			path[level - 1] = std::make_pair(n, n->count);
+			current = n->children[n->count];
+		}
+		return std::make_pair(insert_at(last, last->count, pair_type(std::piecewise_construct, std::forward_as_tuple(key),
+			std::forward_as_tuple(std::forward<Types>(args)...)), path), true);
+	}
+
+	auto leaf = descend(key, path);
+	auto index = pair_index(leaf, key);
+	if (index != leaf->count && !comparator(key, leaf->pairs()[index].first)) {
+		return std::make_pair(iterator{leaf, index, last}, false);
+	}
+
+	return std::make_pair(insert_at(leaf, index, pair_type(std::piecewise_construct, std::forward_as_tuple(key),
+		std::forward_as_tuple(std::forward<Types>(args)...)), path), true);
+}
+
+template<typename K, typename V, typename C, std::size_t N>
+typename btree<K, V, C, N>::iterator btree<K, V, C, N>::insert_at(leaf_node* leaf, std::size_t index, pair_type&& x,
+	std::pair<inner_node*, std::size_t>* path) {
+	if (leaf->count < N) {
+		leaf->shift_right(index);
+		new (leaf->pairs() + index) pair_type{std::move(x)};
+		++leaf->count;
+		++_size;
+		return iterator{leaf, index, last};
+	}
+
+	//the nodes needed by the splits are allocated first, so that nothing changes if an allocation fails
+	auto levels = std::size_t{1};
+	while (levels < height && path[height - 1 - levels].first->count == N) {
+		++levels;
+	}
+	std::unique_ptr<leaf_node> new_leaf{new leaf_node{}};
+	std::unique_ptr<inner_node> new_inners[max_height];
+	for (std::size_t i = 1; i < levels; ++i) {
+		new_inners[i].reset(new inner_node{});
+	}
+	std::unique_ptr<inner_node> new_root{levels == height ? new inner_node{} : nullptr};
+
+	//when appending, the full nodes are kept as they are, so that a tree built in order is packed,
+	//otherwise the pairs are split in halves
+	const auto appending = index == N && !leaf->next;
+	const auto left_count = appending ? N : N / 2;
+	auto right = new_leaf.release();
+	for (auto i = left_count; i != N; ++i) {
+		new (right->pairs() + i - left_count) pair_type{std::move(leaf->pairs()[i])};
+		leaf->pairs()[i].~pair_type();
+	}
+	leaf->count = left_count;
+	right->count = N - left_count;
+	right->previous = leaf;
+	right->next = leaf->next;
+	(leaf->next ? leaf->next->previous : last) = right;
+	leaf->next = right;
+
+	auto target = index <= left_count && !appending ? leaf : right;
+	auto target_index = target == leaf ? index : index - left_count;
+	target->shift_right(target_index);
+	new (target->pairs() + target_index) pair_type{std::move(x)};
+	++target->count;
+	++_size;
+	iterator inserted{target, target_index, last};
+
+	//the separator and the new node are inserted into the parent, which may be split in turn
+	K separator = right->pairs()[0].first;
+	btree_node* child = right;
+	for (std::size_t level = height - 1; level > 0; --level) {
+		auto parent = path[level - 1].first;
+		auto position = path[level - 1].second;
+		if (parent->count < N) {
+			std::copy_backward(parent->keys + position, parent->keys + parent->count, parent->keys + parent->count + 1);
+			std::copy_backward(parent->children + position + 1, parent->children + parent->count + 1, parent->children + parent->count + 2);
+			parent->keys[position] = separator;
+			parent->children[position + 1] = child;
+			++parent->count;
+			return inserted;
+		}
+
+		//N + 1 keys and N + 2 children: the middle key moves up, the ones on its right to the new node
+		K keys[N + 1];
+		btree_node* children[N + 2];
+		std::copy(parent->keys, parent->keys + position, keys);
+		keys[position] = separator;
+		std::copy(parent->keys + position, parent->keys + N, keys + position + 1);
+		std::copy(parent->children, parent->children + position + 1, children);
+		children[position + 1] = child;
+		std::copy(parent->children + position + 1, parent->children + N + 1, children + position + 2);
+
+		auto sibling = new_inners[height - level].release();
+		const auto kept = appending && position == N ? N : N / 2;
+		std::copy(keys, keys + kept, parent->keys);
+		std::fill(parent->keys + kept, parent->keys + N, K{});
+		std::copy(children, children + kept + 1, parent->children);
+		std::fill(parent->children + kept + 1, parent->children + N + 1, nullptr);
+		parent->count = kept;
+		std::copy(keys + kept + 1, keys + N + 1, sibling->keys);
+		std::copy(children + kept + 1, children + N + 2, sibling->children);
+		sibling->count = N - kept;
+
+		separator = keys[kept];
+		child = sibling;
+	}
+
+	//the root has been split
+	auto n = new_root.release();
+	n->keys[0] = separator;
+	n->children[0] = root;
+	n->children[1] = child;
+	n->count = 1;
+	root = n;
+	++height;
+
+	return inserted;
+}
+
+template<typename K, typename V, typename C, std::size_t N>
+void btree<K, V, C, N>::destroy(btree_node* n, std::size_t height) noexcept {
+	if (height == 1) {
+		delete static_cast<leaf_node*>(n);
+		return;
+	}
+
+	auto inner = static_cast<inner_node*>(n);
+	for (std::size_t i = 0; i <= inner->count; ++i) {
+		destroy(inner->children[i], height - 1);
+	}
+	delete inner;
+}
+
+#endif
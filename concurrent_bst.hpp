@@ -0,0 +1,184 @@
+#ifndef __CONCURRENT_BST_HPP__
+#define __CONCURRENT_BST_HPP__
+
+#include <utility>
+#include <functional>
+#include <optional>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "bst.hpp"
+
+//read-mostly bst shared among threads, following the left-right technique: two copies of the tree are kept,
+//readers run on the published one without ever waiting, while a writer (writers are serialized by a mutex)
+//modifies the other copy, publishes it, waits for the readers still on the old copy and repeats the modification there;
+//memory is doubled and each modification is applied twice, so that reads scale with the number of threads
+template<typename key_type, typename value_type, typename Comparator = std::less<key_type>, typename Balancing = red_black>
+class concurrent_bst {
+public:
+	using tree_type = bst<key_type, value_type, Comparator, Balancing>;
+	using pair_type = typename tree_type::pair_type;
+
+	concurrent_bst(): trees{}, published{0}, version{0}, indicators{}, writer{}, stale{false} {
+	}
+
+	explicit concurrent_bst(const tree_type& tree): trees{tree, tree}, published{0}, version{0}, indicators{}, writer{}, stale{false} {
+	}
+
+	concurrent_bst(const concurrent_bst&) = delete;
+	concurrent_bst& operator=(const concurrent_bst&) = delete;
+
+	//runs f(const tree_type&) on a consistent version of the tree and returns its result; wait-free as long as f is,
+	//but f must not let iterators (nor references to the elements) escape
+	template<typename F>
+	decltype(auto) read(F&& f) const;
+
+	//copy of the value of key, if present
+	std::optional<value_type> find(const key_type& key) const {
+		return read([&key](const tree_type& tree) -> std::optional<value_type> {
+			auto iter = tree.find(key);
+			if (iter == tree.end()) {
+				return std::nullopt;
+			}
+			return iter->second;
+		});
+	}
+
+	bool contains(const key_type& key) const {
+		return read([&key](const tree_type& tree) {
+			return tree.find(key) != tree.end();
+		});
+	}
+
+	std::size_t size() const {
+		return read([](const tree_type& tree) {
+			return tree.size();
+		});
+	}
+
+	//runs f(tree_type&) on both copies, one after the other: f must have the same effect on each of them;
+	//if f throws on the first copy nothing is published (strong guarantee), if it throws on the second one
+	//the first is published; either way the copy f failed on is copied over from the published one by the next write
+	template<typename F>
+	void write(F f);
+
+	bool insert(const pair_type& x) {
+		bool inserted = false;
+		write([&x, &inserted](tree_type& tree) {
+			inserted = tree.insert(x).second;
+		});
+
+		return inserted;
+	}
+
+	bool insert_or_assign(const key_type& key, const value_type& value) {
+		bool inserted = false;
+		write([&key, &value, &inserted](tree_type& tree) {
+			auto result = tree.try_emplace(key, value);
+			if (!result.second) {
+				result.first->second = value;
+			}
+			inserted = result.second;
+		});
+
+		return inserted;
+	}
+
+	std::size_t erase(const key_type& key) {
+		std::size_t erased = 0;
+		write([&key, &erased](tree_type& tree) {
+			erased = tree.erase(key);
+		});
+
+		return erased;
+	}
+private:
+	//readers announce themselves on the counter picked by their thread, so that readers on different cores
+	//seldom write to the same cache line
+	struct alignas(64) read_indicator {
+		std::atomic<std::size_t> readers{0};
+	};
+
+	static constexpr std::size_t indicator_count = 64;
+
+	tree_type trees[2];
+	//index of the copy readers run on
+	std::atomic<unsigned> published;
+	//index of the set of indicators new readers announce themselves on
+	std::atomic<unsigned> version;
+	mutable read_indicator indicators[2][indicator_count];
+	std::mutex writer;
+	//whether the copy readers are not on may differ from the published one, after f threw on it (guarded by writer)
+	bool stale;
+
+	static std::size_t indicator_index() noexcept {
+		static thread_local const auto index = std::hash<std::thread::id>{}(std::this_thread::get_id()) % indicator_count;
+		return index;
+	}
+
+	void wait_readers(unsigned v) const noexcept;
+};
+
+template<typename K, typename V, typename C, typename B>
+template<typename F>
+decltype(auto) concurrent_bst<K, V, C, B>::read(F&& f) const {
+	auto& indicator = indicators[version.load()][indicator_index()].readers;
+	indicator.fetch_add(1);
+
+	//the reader departs when f returns, or throws
+	struct departure {
+		std::atomic<std::size_t>& indicator;
+
+		~departure() {
+			indicator.fetch_sub(1);
+		}
+	} guard{indicator};
+
+	return std::forward<F>(f)(trees[published.load()]);
+}
+
+template<typename K, typename V, typename C, typename B>
+template<typename F>
+void concurrent_bst<K, V, C, B>::write(F f) {
+	std::lock_guard<std::mutex> lock{writer};
+	auto p = published.load(std::memory_order_relaxed);
+	//no reader is on trees[1 - p]: it is brought back in line with the published copy first
+	if (stale) {
+		trees[1 - p] = trees[p];
+		stale = false;
+	}
+	try {
+		f(trees[1 - p]);
+	} catch (...) {
+		stale = true;
+		throw;
+	}
+	published.store(1 - p);
+
+	//the readers arrived before the publication may still be on trees[p]: new ones are moved to the other set
+	//of indicators, once it is empty, and the old set is waited for too
+	auto v = version.load(std::memory_order_relaxed);
+	wait_readers(1 - v);
+	version.store(1 - v);
+	wait_readers(v);
+
+	try {
+		f(trees[p]);
+	} catch (...) {
+		stale = true;
+		throw;
+	}
+}
+
+template<typename K, typename V, typename C, typename B>
+void concurrent_bst<K, V, C, B>::wait_readers(unsigned v) const noexcept {
+	for (const auto& indicator : indicators[v]) {
+		while (indicator.readers.load()) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef __FROZEN_BST_HPP__
+#define __FROZEN_BST_HPP__
+
+#include <iostream>
+#include <utility>
+#include <iterator>
+
+#include <vector>
+#include <algorithm>
+
+#include <cassert>
+
+//index arithmetic on an implicit tree in Eytzinger (breadth-first) order, where the root is 1,
+//the children of k are 2k and 2k+1 and 0 stands for no element
+struct eytzinger {
+	static std::size_t leftmost(std::size_t k, std::size_t size) noexcept {
+		if (k > size) {
+			return 0;
+		}
+
+		while (2 * k <= size) {
+			k = 2 * k;
+		}
+
+		return k;
+	}
+
+	static std::size_t successor(std::size_t k, std::size_t size) noexcept {
+		if (2 * k + 1 <= size) {
+			return leftmost(2 * k + 1, size);
+		}
+
+		return parent_of_left_ancestor(k);
+	}
+
+	//climbs while k is a right child, then once more
+	static std::size_t parent_of_left_ancestor(std::size_t k) noexcept {
+#if defined(__GNUC__)
+		return k >> __builtin_ffsll(~k);
+#else
+		while (k & 1) {
+			k >>= 1;
+		}
+		return k >> 1;
+#endif
+	}
+};
+
+//in-order traversal of the implicit tree
+template<typename pair_type>
+class eytzinger_iterator {
+	const pair_type* elements;
+	std::size_t size;
+	std::size_t current;
+public:
+	using value_type = const pair_type;
+	using reference = value_type&;
+	using pointer = value_type*;
+	using difference_type = std::ptrdiff_t;
+	using iterator_category = std::forward_iterator_tag;
+
+	eytzinger_iterator(const pair_type* elements, std::size_t size, std::size_t current) noexcept:
+		elements{elements}, size{size}, current{current} {
+	}
+
+	reference operator*() const noexcept {
+		return elements[current];
+	}
+
+	pointer operator->() const noexcept {
+		return &**this;
+	}
+
+	eytzinger_iterator& operator++() noexcept {
+		current = eytzinger::successor(current, size);
+		return *this;
+	}
+
+	eytzinger_iterator operator++(int) noexcept {
+		auto tmp(*this);
+		++(*this);
+		return tmp;
+	}
+
+	friend
+	bool operator==(const eytzinger_iterator& lhs, const eytzinger_iterator& rhs) noexcept {
+		return lhs.current == rhs.current;
+	}
+
+	friend
+	bool operator!=(const eytzinger_iterator& lhs, const eytzinger_iterator& rhs) noexcept {
+		return !(lhs == rhs);
+	}
+};
+
+//read-only snapshot of a sorted container, laid out in one array in Eytzinger order: the top levels share cache lines
+//and a search is a branch-free descent with the next levels prefetched; index 0 is an unused sentinel,
+//hence key_type and value_type must be default constructible
+template<typename key_type, typename value_type, typename Comparator = std::less<key_type>>
+class frozen_bst {
+public:
+	using pair_type = std::pair<key_type, value_type>;
+
+	using const_iterator = eytzinger_iterator<pair_type>;
+	using iterator = const_iterator;
+
+	frozen_bst(): elements(1), comparator{} {
+	}
+
+	//tree must iterate its pairs in the order given by its key_comp()
+	template<typename tree_type>
+	explicit frozen_bst(const tree_type& tree): elements(tree.size() + 1), comparator{tree.key_comp()} {
+		auto k = eytzinger::leftmost(1, size());
+		for (const auto& p : tree) {
+			assert(k);
+			elements[k] = pair_type{p.first, p.second};
+			k = eytzinger::successor(k, size());
+		}
+		assert(!k);
+	}
+
+	Comparator key_comp() const {
+		return comparator;
+	}
+
+	std::size_t size() const noexcept {
+		return elements.size() - 1;
+	}
+
+	const_iterator begin() const noexcept {
+		return const_iterator{elements.data(), size(), eytzinger::leftmost(1, size())};
+	}
+
+	const_iterator end() const noexcept {
+		return const_iterator{elements.data(), size(), 0};
+	}
+
+	const_iterator cbegin() const noexcept {
+		return begin();
+	}
+
+	const_iterator cend() const noexcept {
+		return end();
+	}
+
+	const_iterator find(const key_type& key) const;
+
+	friend
+	std::ostream& operator<<(std::ostream& os, const frozen_bst& tree) {
+		os << "frozen_bst(" << tree.size() << ") {";
+		for (const auto& p : tree) {
+			os << "(" << p.first << ": " << p.second << "), ";
+		}
+
+		return os << "}";
+	}
+private:
+	std::vector<pair_type> elements;
+	Comparator comparator;
+};
+
+template<typename K, typename V, typename C>
+typename frozen_bst<K, V, C>::const_iterator frozen_bst<K, V, C>::find(const K& key) const {
+	const auto n = size();
+	const auto base = elements.data();
+	std::size_t k = 1;
+	while (k <= n) {
+#if defined(__GNUC__)
+		//the descendants four levels below are contiguous
+		__builtin_prefetch(base + std::min(16 * k, n));
+#endif
+		//right when the element is smaller than key, left otherwise
+		k = 2 * k + comparator(base[k].first, key);
+	}
+
+	//undo the final right turns, and the left one, to reach the first element not smaller than key
+	k = eytzinger::parent_of_left_ancestor(k);
+	if (k && !comparator(key, base[k].first)) {
+		return const_iterator{base, n, k};
+	}
+
+	return end();
+}
+
+#endif
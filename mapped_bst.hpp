@@ -0,0 +1,255 @@
+#ifndef __MAPPED_BST_HPP__
+#define __MAPPED_BST_HPP__
+
+#include <iostream>
+#include <utility>
+#include <new>
+#include <functional>
+#include <type_traits>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <system_error>
+#include <stdexcept>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//read-only, memory-mapped view of a sorted container saved to a binary file by save(): a header followed by
+//the pairs as they are laid out in memory, in key order; opening the file maps it without reading it, the pages
+//being loaded by the searches (binary searches on the array) as they touch them, and a bst can be rebuilt
+//in linear time through its sorted_unique constructor over [begin(), end()).
+//keys and values must be trivially copyable and their pair standard layout: the file stores the in-memory layout
+//of the pairs, padding included, of which the header only checks the sizes, so files are only portable among builds
+//with the same layout
+template<typename key_type, typename value_type, typename Comparator = std::less<key_type>>
+class mapped_bst {
+public:
+	using pair_type = std::pair<key_type, value_type>;
+
+	using const_iterator = const pair_type*;
+	using iterator = const_iterator;
+
+	static_assert(std::is_trivially_copyable<key_type>::value && std::is_trivially_copyable<value_type>::value,
+		"only trivially copyable keys and values can be saved as bytes");
+	static_assert(std::is_standard_layout<pair_type>::value,
+		"the pairs are read back from the file through pointers, so their layout must be standard");
+
+	//writes the pairs of tree, which must iterate them in the order given by Comparator, to path; a file already
+	//at path is replaced keeping its permissions, while a new file is only accessible to its owner (mode 0600)
+	template<typename tree_type>
+	static void save(const tree_type& tree, const std::string& path);
+
+	explicit mapped_bst(const std::string& path, const Comparator& comparator = Comparator{});
+
+	mapped_bst(const mapped_bst&) = delete;
+	mapped_bst& operator=(const mapped_bst&) = delete;
+
+	~mapped_bst() {
+		::munmap(mapping, mapping_size);
+	}
+
+	Comparator key_comp() const {
+		return comparator;
+	}
+
+	std::size_t size() const noexcept {
+		return _size;
+	}
+
+	const_iterator begin() const noexcept {
+		return elements;
+	}
+
+	const_iterator end() const noexcept {
+		return elements + _size;
+	}
+
+	const_iterator cbegin() const noexcept {
+		return begin();
+	}
+
+	const_iterator cend() const noexcept {
+		return end();
+	}
+
+	//first element whose key is not less than key
+	const_iterator lower_bound(const key_type& key) const {
+		return std::lower_bound(begin(), end(), key, [this](const pair_type& p, const key_type& k) {
+			return comparator(p.first, k);
+		});
+	}
+
+	const_iterator find(const key_type& key) const {
+		auto iter = lower_bound(key);
+		if (iter != end() && !comparator(key, iter->first)) {
+			return iter;
+		}
+
+		return end();
+	}
+
+	friend
+	std::ostream& operator<<(std::ostream& os, const mapped_bst& tree) {
+		os << "mapped_bst(" << tree.size() << ") {";
+		for (const auto& p : tree) {
+			os << "(" << p.first << ": " << p.second << "), ";
+		}
+
+		return os << "}";
+	}
+private:
+	//the pairs follow the header, which is as large as a cache line to keep them aligned
+	struct alignas(64) header {
+		char magic[8];
+		std::uint64_t key_size;
+		std::uint64_t value_size;
+		std::uint64_t pair_size;
+		std::uint64_t size;
+	};
+
+	static_assert(alignof(pair_type) <= alignof(header), "the pairs must be aligned in the mapping");
+
+	static constexpr char file_magic[8] = {'b', 's', 't', 'm', 'a', 'p', '1', '\0'};
+
+	void* mapping;
+	std::size_t mapping_size;
+	const pair_type* elements;
+	std::size_t _size;
+	Comparator comparator;
+};
+
+template<typename K, typename V, typename C>
+constexpr char mapped_bst<K, V, C>::file_magic[8];
+
+template<typename K, typename V, typename C>
+template<typename tree_type>
+void mapped_bst<K, V, C>::save(const tree_type& tree, const std::string& path) {
+	//the pairs go to a temporary file of the same directory, renamed over path once complete and synced:
+	//a mapped_bst which has path mapped keeps reading the former file, and a failure (e.g. a full disk)
+	//leaves path as it was
+	std::string temporary = path + ".XXXXXX";
+	auto fd = ::mkstemp(&temporary[0]);
+	if (fd < 0) {
+		throw std::system_error{errno, std::generic_category(), "cannot create a temporary file for " + path};
+	}
+
+	auto fail = [](const std::string& what) {
+		throw std::system_error{errno, std::generic_category(), what};
+	};
+
+	//whatever throws (a system call, allocating block or copying a pair) closes and removes the temporary file
+	try {
+		//writes the whole of [data, data + bytes), which write() may take in several parts
+		auto write_all = [&fd, &fail, &temporary](const char* data, std::size_t bytes) {
+			while (bytes) {
+				auto written = ::write(fd, data, bytes);
+				if (written < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					fail("cannot write " + temporary);
+				}
+				data += written;
+				bytes -= written;
+			}
+		};
+
+		//zeroed before the objects are constructed in it, hence so are the padding bytes
+		header h;
+		std::memset(static_cast<void*>(&h), 0, sizeof(h));
+		std::memcpy(h.magic, file_magic, sizeof(file_magic));
+		h.key_size = sizeof(K);
+		h.value_size = sizeof(V);
+		h.pair_size = sizeof(pair_type);
+		h.size = tree.size();
+		write_all(reinterpret_cast<const char*>(&h), sizeof(h));
+
+		//the pairs are written by blocks of about 64KiB
+		struct alignas(pair_type) slot {
+			unsigned char bytes[sizeof(pair_type)];
+		};
+		std::vector<slot> block((std::size_t{1} << 16) / sizeof(pair_type) + 1);
+		std::size_t count = 0;
+		for (const auto& x : tree) {
+			if (count == block.size()) {
+				write_all(reinterpret_cast<const char*>(block.data()), count * sizeof(pair_type));
+				count = 0;
+			}
+			auto p = block[count++].bytes;
+			std::memset(p, 0, sizeof(pair_type));
+			new (p) pair_type{x.first, x.second};
+		}
+		write_all(reinterpret_cast<const char*>(block.data()), count * sizeof(pair_type));
+
+		//a file replaced at path keeps its mode, a new one keeps the 0600 of mkstemp
+		struct stat existing;
+		if (!::stat(path.c_str(), &existing) && ::fchmod(fd, existing.st_mode & 07777)) {
+			fail("cannot write " + temporary);
+		}
+		if (::fsync(fd)) {
+			fail("cannot write " + temporary);
+		}
+	} catch (...) {
+		::close(fd);
+		::unlink(temporary.c_str());
+		throw;
+	}
+
+	if (::close(fd)) {
+		auto error = errno;
+		::unlink(temporary.c_str());
+		throw std::system_error{error, std::generic_category(), "cannot write " + temporary};
+	}
+	if (::rename(temporary.c_str(), path.c_str())) {
+		auto error = errno;
+		::unlink(temporary.c_str());
+		throw std::system_error{error, std::generic_category(), "cannot rename " + temporary + " to " + path};
+	}
+}
+
+template<typename K, typename V, typename C>
+mapped_bst<K, V, C>::mapped_bst(const std::string& path, const C& comparator):
+	mapping{MAP_FAILED}, mapping_size{}, elements{}, _size{}, comparator{comparator} {
+	auto fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::system_error{errno, std::generic_category(), "cannot open " + path};
+	}
+
+	struct stat status;
+	auto error = EINVAL;
+	if (::fstat(fd, &status)) {
+		error = errno;
+	} else if (static_cast<std::size_t>(status.st_size) >= sizeof(header)) {
+		mapping_size = status.st_size;
+		mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		error = errno;
+	}
+	//the mapping outlives the descriptor
+	::close(fd);
+	if (mapping == MAP_FAILED) {
+		throw std::system_error{error, std::generic_category(), "cannot map " + path};
+	}
+
+	auto h = static_cast<const header*>(mapping);
+	if (std::memcmp(h->magic, file_magic, sizeof(file_magic)) || h->key_size != sizeof(K) || h->value_size != sizeof(V)
+		|| h->pair_size != sizeof(pair_type) || h->size != (mapping_size - sizeof(header)) / sizeof(pair_type)
+		|| mapping_size != sizeof(header) + h->size * sizeof(pair_type)) {
+		::munmap(mapping, mapping_size);
+		throw std::runtime_error{path + " does not hold pairs of this type"};
+	}
+
+	elements = reinterpret_cast<const pair_type*>(h + 1);
+	_size = h->size;
+}
+
+#endif
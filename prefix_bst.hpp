@@ -0,0 +1,328 @@
+#ifndef __PREFIX_BST_HPP__
+#define __PREFIX_BST_HPP__
+
+#include <iostream>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <optional>
+#include <array>
+
+#include <algorithm>
+#include <type_traits>
+
+#include "bst.hpp"
+
+//split of fixed-width keys of N words into a prefix of N - S words and a suffix of S words (a plain word when S is 1)
+template<typename T, std::size_t N, std::size_t S>
+struct prefix_split {
+	using key_type = std::array<T, N>;
+	using prefix_type = std::array<T, N - S>;
+	using suffix_type = std::conditional_t<S == 1, T, std::array<T, S>>;
+
+	static prefix_type prefix(const key_type& key) noexcept {
+		prefix_type p;
+		std::copy_n(key.begin(), N - S, p.begin());
+		return p;
+	}
+
+	static suffix_type suffix(const key_type& key) noexcept {
+		if constexpr (S == 1) {
+			return key[N - 1];
+		} else {
+			suffix_type s;
+			std::copy_n(key.begin() + (N - S), S, s.begin());
+			return s;
+		}
+	}
+
+	static key_type join(const prefix_type& prefix, const suffix_type& suffix) noexcept {
+		key_type key;
+		std::copy_n(prefix.begin(), N - S, key.begin());
+		if constexpr (S == 1) {
+			key[N - 1] = suffix;
+		} else {
+			std::copy_n(suffix.begin(), S, key.begin() + (N - S));
+		}
+		return key;
+	}
+};
+
+//in-order iterator on a prefix_bst: the full keys are not stored, hence dereferencing gives a pair holding a copy
+//of the key (joined from the group's prefix and the element's suffix) and a reference to the value
+template<typename split, typename outer_iterator, typename inner_iterator>
+class prefix_iterator {
+	template<typename, typename, typename>
+	friend class prefix_iterator;
+
+	template<typename, std::size_t, typename, typename, std::size_t>
+	friend class prefix_bst;
+
+	outer_iterator group;
+	outer_iterator last_group;
+	//empty at the end, as groups are never empty
+	std::optional<inner_iterator> current;
+public:
+	using value_type = std::pair<typename split::key_type, decltype((std::declval<inner_iterator>()->second))>;
+	using reference = value_type;
+	using difference_type = std::ptrdiff_t;
+	using iterator_category = std::input_iterator_tag;
+
+	//the pair outlives the expression iter->member
+	struct pointer {
+		value_type p;
+
+		const value_type* operator->() const noexcept {
+			return &p;
+		}
+	};
+
+	prefix_iterator(outer_iterator group, outer_iterator last_group) noexcept: group{group}, last_group{last_group}, current{} {
+		if (group != last_group) {
+			current = group->second.begin();
+		}
+	}
+
+	prefix_iterator(outer_iterator group, outer_iterator last_group, inner_iterator current) noexcept:
+		group{group}, last_group{last_group}, current{current} {
+	}
+
+	//iterator to const_iterator conversion
+	template<typename O, typename I, typename = std::enable_if_t<std::is_convertible<O, outer_iterator>::value>>
+	prefix_iterator(const prefix_iterator<split, O, I>& other) noexcept: group{other.group}, last_group{other.last_group}, current{} {
+		if (other.current) {
+			current = *other.current;
+		}
+	}
+
+	reference operator*() const noexcept {
+		return value_type{split::join(group->first, (*current)->first), (*current)->second};
+	}
+
+	pointer operator->() const noexcept {
+		return pointer{**this};
+	}
+
+	prefix_iterator& operator++() noexcept {
+		if (++*current == group->second.end()) {
+			++group;
+			current.reset();
+			if (group != last_group) {
+				current = group->second.begin();
+			}
+		}
+
+		return *this;
+	}
+
+	prefix_iterator operator++(int) noexcept {
+		auto tmp(*this);
+		++(*this);
+		return tmp;
+	}
+
+	friend
+	bool operator==(const prefix_iterator& lhs, const prefix_iterator& rhs) noexcept {
+		return lhs.group == rhs.group && lhs.current == rhs.current;
+	}
+
+	friend
+	bool operator!=(const prefix_iterator& lhs, const prefix_iterator& rhs) noexcept {
+		return !(lhs == rhs);
+	}
+};
+
+//ordered map of fixed-width keys (std::array<T, N>, in lexicographic order) which stores each distinct prefix
+//of the first N - suffix_size words once: elements are grouped by prefix in a bst, each group being a bst of the
+//suffixes alone. A lookup compares whole prefixes among the groups (one comparison per level, through three_way_less),
+//then only suffixes, and the nodes hold suffix_size words instead of N.
+//this pays off when the keys share few prefixes; with as many prefixes as elements, each element costs a group more
+template<typename T, std::size_t N, typename value_type, typename Balancing = red_black, std::size_t suffix_size = 1>
+class prefix_bst {
+	static_assert(suffix_size >= 1 && suffix_size < N, "keys must be split into a prefix and a suffix of at least one word each");
+public:
+	using split = prefix_split<T, N, suffix_size>;
+	using key_type = typename split::key_type;
+	using prefix_type = typename split::prefix_type;
+	using suffix_type = typename split::suffix_type;
+	using suffix_compare = std::conditional_t<suffix_size == 1, std::less<T>, three_way_less<suffix_type>>;
+
+	using group_type = bst<suffix_type, value_type, suffix_compare, Balancing>;
+	using tree_type = bst<prefix_type, group_type, three_way_less<prefix_type>, Balancing>;
+
+	using iterator = prefix_iterator<split, typename tree_type::iterator, typename group_type::iterator>;
+	using const_iterator = prefix_iterator<split, typename tree_type::const_iterator, typename group_type::const_iterator>;
+
+	prefix_bst() = default;
+
+	prefix_bst(const prefix_bst&) = default;
+	prefix_bst& operator=(const prefix_bst&) = default;
+
+	prefix_bst(prefix_bst&& other) noexcept: groups{std::move(other.groups)}, _size{std::exchange(other._size, 0)} {
+	}
+
+	prefix_bst& operator=(prefix_bst&& other) noexcept {
+		groups = std::move(other.groups);
+		_size = std::exchange(other._size, 0);
+		return *this;
+	}
+
+	std::size_t size() const noexcept {
+		return _size;
+	}
+
+	//number of distinct prefixes
+	std::size_t prefixes() const noexcept {
+		return groups.size();
+	}
+
+	iterator begin() noexcept {
+		return iterator{groups.begin(), groups.end()};
+	}
+
+	const_iterator begin() const noexcept {
+		return const_iterator{groups.begin(), groups.end()};
+	}
+
+	iterator end() noexcept {
+		return iterator{groups.end(), groups.end()};
+	}
+
+	const_iterator end() const noexcept {
+		return const_iterator{groups.end(), groups.end()};
+	}
+
+	const_iterator cbegin() const noexcept {
+		return begin();
+	}
+
+	const_iterator cend() const noexcept {
+		return end();
+	}
+
+	iterator find(const key_type& key) {
+		return _find<iterator>(groups, key);
+	}
+
+	const_iterator find(const key_type& key) const {
+		return _find<const_iterator>(groups, key);
+	}
+
+	//first element whose key is not less than key
+	iterator lower_bound(const key_type& key) {
+		return _lower_bound<iterator>(groups, key);
+	}
+
+	const_iterator lower_bound(const key_type& key) const {
+		return _lower_bound<const_iterator>(groups, key);
+	}
+
+	//the value is constructed (from args) only when key is not already present
+	template<typename... Types>
+	std::pair<iterator, bool> try_emplace(const key_type& key, Types&&... args);
+
+	std::pair<iterator, bool> insert(const std::pair<const key_type, value_type>& x) {
+		return try_emplace(x.first, x.second);
+	}
+
+	value_type& operator[](const key_type& key) {
+		return (*try_emplace(key).first.current)->second;
+	}
+
+	//a group left empty is erased along with its prefix
+	std::size_t erase(const key_type& key);
+
+	void clear() noexcept {
+		groups.clear();
+		_size = 0;
+	}
+
+	friend
+	std::ostream& operator<<(std::ostream& os, const prefix_bst& tree) {
+		os << "prefix_bst(" << tree.size() << ") {";
+		for (const auto& p : tree) {
+			os << "([";
+			for (std::size_t i = 0; i != N; ++i) {
+				os << (i ? ", " : "") << p.first[i];
+			}
+			os << "]: " << p.second << "), ";
+		}
+
+		return os << "}";
+	}
+private:
+	tree_type groups;
+	std::size_t _size = 0;
+
+	template<typename iterator_type, typename groups_type>
+	static iterator_type _find(groups_type& groups, const key_type& key);
+
+	template<typename iterator_type, typename groups_type>
+	static iterator_type _lower_bound(groups_type& groups, const key_type& key);
+};
+
+template<typename T, std::size_t N, typename V, typename B, std::size_t S>
+template<typename iterator_type, typename groups_type>
+iterator_type prefix_bst<T, N, V, B, S>::_find(groups_type& groups, const key_type& key) {
+	auto group = groups.find(split::prefix(key));
+	if (group != groups.end()) {
+		auto current = group->second.find(split::suffix(key));
+		if (current != group->second.end()) {
+			return iterator_type{group, groups.end(), current};
+		}
+	}
+
+	return iterator_type{groups.end(), groups.end()};
+}
+
+template<typename T, std::size_t N, typename V, typename B, std::size_t S>
+template<typename iterator_type, typename groups_type>
+iterator_type prefix_bst<T, N, V, B, S>::_lower_bound(groups_type& groups, const key_type& key) {
+	const auto prefix = split::prefix(key);
+	auto group = groups.lower_bound(prefix);
+	if (group != groups.end() && !groups.key_comp()(prefix, group->first)) {
+		auto current = group->second.lower_bound(split::suffix(key));
+		if (current != group->second.end()) {
+			return iterator_type{group, groups.end(), current};
+		}
+		//all the suffixes of the group are smaller: the bound is the first element of the next group
+		++group;
+	}
+
+	return iterator_type{group, groups.end()};
+}
+
+template<typename T, std::size_t N, typename V, typename B, std::size_t S>
+template<typename... Types>
+std::pair<typename prefix_bst<T, N, V, B, S>::iterator, bool> prefix_bst<T, N, V, B, S>::try_emplace(const key_type& key, Types&&... args) {
+	auto group = groups.try_emplace(split::prefix(key)).first;
+	try {
+		auto result = group->second.try_emplace(split::suffix(key), std::forward<Types>(args)...);
+		_size += result.second;
+		return std::make_pair(iterator{group, groups.end(), result.first}, result.second);
+	} catch (...) {
+		//a group created for key must not be left empty
+		if (!group->second.size()) {
+			groups.erase(group);
+		}
+		throw;
+	}
+}
+
+template<typename T, std::size_t N, typename V, typename B, std::size_t S>
+std::size_t prefix_bst<T, N, V, B, S>::erase(const key_type& key) {
+	auto group = groups.find(split::prefix(key));
+	if (group == groups.end()) {
+		return 0;
+	}
+
+	auto erased = group->second.erase(split::suffix(key));
+	if (!group->second.size()) {
+		groups.erase(group);
+	}
+	_size -= erased;
+
+	return erased;
+}
+
+#endif
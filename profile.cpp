@@ -1,23 +1,210 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <fstream>
 
 #include <map>
 #include <string>
+#include <string_view>
 #include <array>
 
 #include <chrono>
 #include <random>
 #include <thread>
+#include <mutex>
+#include <atomic>
 
 #include <numeric>
 #include <algorithm>
+#include <limits>
+
+#include <new>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdio>
 
 #include "bst.hpp"
+#include "frozen_bst.hpp"
+#include "concurrent_bst.hpp"
+#include "mapped_bst.hpp"
+#include "btree.hpp"
+#include "prefix_bst.hpp"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//every heap allocation of the program is counted, to compare per-node allocations against arenas,
+//along with the bytes requested; the counters are atomic, as the threaded benchmarks allocate from several threads
+std::atomic<std::size_t> allocations{0};
+std::atomic<std::size_t> allocated_bytes{0};
+
+//all the forms of operator new and operator delete are replaced, so that every allocation is counted
+//and every deallocation goes back to the C allocator it came from
+static void* counted_allocation(std::size_t size, std::size_t alignment) noexcept {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	if (alignment <= alignof(std::max_align_t)) {
+		return std::malloc(size ? size : 1);
+	}
+
+	//aligned_alloc requires a multiple of the alignment
+	return std::aligned_alloc(alignment, size ? (size + alignment - 1) / alignment * alignment : alignment);
+}
+
+static void* counted_allocation_or_throw(std::size_t size, std::size_t alignment) {
+	if (auto p = counted_allocation(size, alignment)) {
+		return p;
+	}
+
+	throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t size) {
+	return counted_allocation_or_throw(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size) {
+	return counted_allocation_or_throw(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	return counted_allocation_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	return counted_allocation_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return counted_allocation(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return counted_allocation(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return counted_allocation(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return counted_allocation(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+	std::free(p);
+}
+
+//last level cache misses of the calling thread, counted by the kernel through perf_event_open; unavailable elsewhere,
+//and where the kernel or the sandbox forbids it (see /proc/sys/kernel/perf_event_paranoid)
+class cache_miss_counter {
+public:
+	cache_miss_counter() {
+#if defined(__linux__)
+		perf_event_attr attributes{};
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.size = sizeof(attributes);
+		attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		fd = static_cast<int>(::syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+	}
+
+	cache_miss_counter(const cache_miss_counter&) = delete;
+	cache_miss_counter& operator=(const cache_miss_counter&) = delete;
+
+	~cache_miss_counter() {
+#if defined(__linux__)
+		if (fd >= 0) {
+			::close(fd);
+		}
+#endif
+	}
+
+	bool available() const noexcept {
+		return fd >= 0;
+	}
+
+	void start() noexcept {
+#if defined(__linux__)
+		if (fd >= 0) {
+			::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	//misses since start()
+	std::uint64_t stop() noexcept {
+		std::uint64_t misses = 0;
+#if defined(__linux__)
+		if (fd >= 0) {
+			::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (::read(fd, &misses, sizeof(misses)) != sizeof(misses)) {
+				misses = 0;
+			}
+		}
+#endif
+		return misses;
+	}
+private:
+	int fd = -1;
+};
 
 template<typename A, typename B>
 void profile_insertions(A& container, B& keygen, std::size_t size, bool print=true) {
 	std::size_t comps = 0, worst_comps = 0, best_comps = container.size();
+	auto allocs = allocations.load();
 	auto start = std::chrono::high_resolution_clock::now();
 	std::size_t i = 0, target = container.size() + size;
 	while (container.size() != target) {
@@ -36,10 +223,100 @@ void profile_insertions(A& container, B& keygen, std::size_t size, bool print=tr
 
 	if (print) {
     	std::cout << i << " random insertions: " << elapsed.count() << " final size: " << container.size()
-			<< " comparisons total: " << comps << " best: " << best_comps << " worst: " << worst_comps << std::endl;
+			<< " comparisons total: " << comps << " best: " << best_comps << " worst: " << worst_comps
+			<< " allocations: " << allocations - allocs << std::endl;
 	}
 }
 
+template<typename A, typename B, typename F>
+void profile_load(A& container, const B& pairs, F load, const std::string& method) {
+	auto comp = container.key_comp();
+	auto allocs = allocations.load();
+	auto start = std::chrono::high_resolution_clock::now();
+	load(container, pairs);
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end - start;
+	auto comp2 = container.key_comp();
+
+	std::cout << pairs.size() << " " << method << ": " << elapsed.count() << " final size: " << container.size()
+		<< " comparisons total: " << comp2.comparisons - comp.comparisons << " allocations: " << allocations - allocs << std::endl;
+}
+
+template<typename A>
+void profile_clear(A& container) {
+	auto size = container.size();
+	auto start = std::chrono::high_resolution_clock::now();
+	container.clear();
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end - start;
+
+	std::cout << "clear of " << size << " elements: " << elapsed.count() << std::endl;
+}
+
+//export of the whole container to the file at path, through write_file(container, path)
+template<typename A, typename F>
+void profile_dump(const A& container, const std::string& path, F write_file, const std::string& method) {
+	auto allocs = allocations.load();
+	auto start = std::chrono::high_resolution_clock::now();
+	auto bytes = write_file(container, path);
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end - start;
+
+	std::cout << container.size() << " elements " << method << ": " << elapsed.count() << " (" << bytes / elapsed.count() / (1 << 20) << " MiB/s, "
+		<< elapsed.count() * 1e9 / container.size() << " ns/element) bytes: " << bytes << " allocations: " << allocations - allocs << std::endl;
+	std::remove(path.c_str());
+}
+
+//op(lhs, rhs) on copies of lhs and rhs, e.g. a merge of rhs into lhs
+template<typename A, typename F>
+void profile_set_operation(const A& lhs, const A& rhs, F op, const std::string& method) {
+	A first{lhs}, second{rhs};
+	auto comp = first.key_comp();
+	auto allocs = allocations.load();
+	auto start = std::chrono::high_resolution_clock::now();
+	op(first, second);
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end - start;
+	auto comp2 = first.key_comp();
+
+	std::cout << lhs.size() << " and " << rhs.size() << " elements " << method << ": " << elapsed.count() << " final sizes: " << first.size()
+		<< " and " << second.size() << " comparisons total: " << comp2.comparisons - comp.comparisons << " allocations: " << allocations - allocs << std::endl;
+}
+
+//lookups of keys given as string_views, through find(container, key)
+template<typename A, typename F>
+void profile_lookups(const A& container, const std::vector<std::string_view>& keys, F find, const std::string& method) {
+	std::size_t hits = 0;
+	auto allocs = allocations.load();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (const auto& key : keys) {
+		hits += find(container, key) != container.end();
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end - start;
+
+	std::cout << keys.size() << " " << method << ": " << elapsed.count() << " (" << elapsed.count() * 1e9 / keys.size() << " ns/search)"
+		<< " allocations: " << allocations - allocs << " (" << double(allocations - allocs) / keys.size() << " per search)"
+		<< " (hits " << hits << ")" << std::endl;
+}
+
+//copy construction, then copy assignment over the copy (which frees its nodes first)
+template<typename A>
+void profile_copy(const A& container, const std::string& method) {
+	auto allocs = allocations.load();
+	auto start = std::chrono::high_resolution_clock::now();
+	A copy{container};
+	auto middle = std::chrono::high_resolution_clock::now();
+	copy = container;
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> copy_elapsed = middle - start;
+	std::chrono::duration<double> assign_elapsed = end - middle;
+
+	std::cout << container.size() << " " << method << ": copy took " << copy_elapsed.count()
+		<< " (" << copy_elapsed.count() * 1e9 / container.size() << " ns/element) assignment took " << assign_elapsed.count()
+		<< " (" << assign_elapsed.count() * 1e9 / container.size() << " ns/element) allocations: " << allocations - allocs << std::endl;
+}
+
 template<typename A, typename B>
 void profile_find(const A& container, B& keygen, std::size_t searches, bool print=true) {
 	std::size_t hits = 0, comps = 0, worst_comps = 0, best_comps = container.size();
@@ -71,12 +348,197 @@ void profile_find(const A& container, B& keygen, std::size_t searches, bool prin
     std::chrono::duration<double> elapsed = end - start;
 
 	if (print) {
-    	std::cout << searches << " random searches: " << elapsed.count() << " worst case: " << worst_case
+    	std::cout << searches << " random searches: " << elapsed.count() << " (" << elapsed.count() * 1e9 / searches << " ns/search)"
+			<< " worst case: " << worst_case
 			<< " comparisons total: " << comps << " best: " << best_comps << " worst: " << worst_comps
 			<< " (hits " << hits << ")" << std::endl;
 	}
 }
 
+template<typename A, typename B>
+void profile_find_many(const A& container, B& keygen, std::size_t searches, bool sorted) {
+	std::vector<decltype(keygen())> keys;
+	keys.reserve(searches);
+	for (std::size_t i = 0; i < searches; ++i) {
+		keys.push_back(keygen());
+	}
+	if (sorted) {
+		std::sort(keys.begin(), keys.end());
+	}
+	std::vector<typename A::const_iterator> results;
+	results.reserve(searches);
+
+	auto comp = container.key_comp();
+	auto start = std::chrono::high_resolution_clock::now();
+	container.find_many(keys.begin(), keys.end(), std::back_inserter(results));
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end - start;
+	auto comp2 = container.key_comp();
+
+	auto hits = std::count_if(results.begin(), results.end(), [&container](const auto& iter) { return iter != container.end(); });
+	std::cout << searches << (sorted ? " sorted" : " random") << " batch searches: " << elapsed.count()
+		<< " (" << elapsed.count() * 1e9 / searches << " ns/search)"
+		<< " comparisons total: " << comp2.comparisons - comp.comparisons << " (hits " << hits << ")" << std::endl;
+}
+
+//large value counting every construction, to measure the temporaries created by the insertion functions
+struct heavy_value {
+	static std::size_t constructions;
+	std::array<std::size_t, 32> payload;
+
+	heavy_value(): payload{} {
+		++constructions;
+	}
+
+	heavy_value(const heavy_value& other): payload{other.payload} {
+		++constructions;
+	}
+
+	heavy_value(heavy_value&& other) noexcept: payload{other.payload} {
+		++constructions;
+	}
+
+	heavy_value& operator=(const heavy_value& other) = default;
+};
+
+std::size_t heavy_value::constructions = 0;
+
+template<typename A, typename B, typename F>
+void profile_heavy(A& container, B& keygen, std::size_t size, F insert, const std::string& method) {
+	auto constructions = heavy_value::constructions;
+	auto allocs = allocations.load();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (std::size_t i = 0; i < size; ++i) {
+		insert(container, keygen(), i);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end - start;
+
+	std::cout << size << " " << method << ": " << elapsed.count() << " final size: " << container.size()
+		<< " value constructions: " << heavy_value::constructions - constructions << " allocations: " << allocations - allocs << std::endl;
+}
+
+//mixed workload cycling through insertion, erasure and search of random keys, whose range makes about half of them present
+template<typename A, typename B>
+void profile_churn(A& container, B& keygen, std::size_t operations) {
+	std::size_t inserted = 0, erased = 0, hits = 0;
+	auto allocs = allocations.load();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (std::size_t i = 0; i < operations; ++i) {
+		auto k = keygen();
+		switch (i % 3) {
+			case 0:
+				inserted += container.insert(std::make_pair(k, i)).second;
+				break;
+			case 1:
+				erased += container.erase(k);
+				break;
+			default:
+				hits += container.find(k) != container.end();
+		}
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end - start;
+
+	std::cout << operations << " churn operations: " << elapsed.count() << " (" << elapsed.count() * 1e9 / operations << " ns/operation)"
+		<< " final size: " << container.size() << " inserted: " << inserted << " erased: " << erased << " (hits " << hits << ")"
+		<< " allocations: " << allocations - allocs << std::endl;
+}
+
+//range queries [k, k + width * step) from random keys k, where step is the average distance between keys,
+//so that width is about the number of elements per range; scan yields the number of elements in the range
+template<typename A, typename B, typename F>
+void profile_range(const A& container, B& keygen, std::size_t searches, std::size_t width, std::size_t step, F scan, const std::string& method) {
+	std::size_t elements = 0;
+	auto comp = container.key_comp();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (std::size_t i = 0; i < searches; ++i) {
+		auto lo = keygen();
+		auto hi = lo;
+		auto& last = hi[std::tuple_size<decltype(hi)>::value - 1];
+		last += std::min(width * step, std::numeric_limits<std::size_t>::max() - last);
+		elements += scan(container, lo, hi);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end - start;
+	auto comp2 = container.key_comp();
+
+	std::cout << searches << " " << method << " of width " << width << ": " << elapsed.count()
+		<< " (" << elapsed.count() * 1e9 / searches << " ns/range)" << " elements: " << elements
+		<< " comparisons total: " << comp2.comparisons - comp.comparisons << std::endl;
+}
+
+//percentile queries: the element at a random percentile (select) and the percentile of a random key (rank)
+template<typename A, typename B, typename S, typename R>
+void profile_percentiles(const A& container, B& keygen, std::size_t searches, S select, R rank, const std::string& method) {
+	std::uniform_int_distribution<std::size_t> percentiles{0, 99};
+	std::mt19937 engine{};
+	std::size_t checksum = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (std::size_t i = 0; i < searches; ++i) {
+		checksum += select(container, percentiles(engine) * container.size() / 100)->second;
+	}
+	auto middle = std::chrono::high_resolution_clock::now();
+	for (std::size_t i = 0; i < searches; ++i) {
+		checksum += rank(container, keygen()) * 100 / container.size();
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> select_elapsed = middle - start;
+	std::chrono::duration<double> rank_elapsed = end - middle;
+
+	std::cout << searches << " " << method << " percentile selections: " << select_elapsed.count()
+		<< " (" << select_elapsed.count() * 1e9 / searches << " ns/query)"
+		<< " ranks: " << rank_elapsed.count() << " (" << rank_elapsed.count() * 1e9 / searches << " ns/query)"
+		<< " checksum: " << checksum << std::endl;
+}
+
+//lookups split among readers threads, while one more thread inserts a random key every 100 microseconds;
+//find(container, key) and insert(container, key, i) are called concurrently
+template<typename K, typename A, typename F, typename I>
+void profile_threads(A& container, std::size_t readers, std::size_t searches, std::size_t seed, F find, I insert, const std::string& method) {
+	auto make_keygen = [](std::size_t seed) {
+		return [engine = std::mt19937(seed), dist = std::uniform_int_distribution<std::size_t>{}]() mutable {
+			K k{0};
+			k[std::tuple_size<K>::value - 1] = dist(engine);
+			return k;
+		};
+	};
+
+	std::atomic<bool> done{false};
+	std::atomic<std::size_t> hits{0};
+	std::size_t writes = 0;
+	std::thread writer{[&]() {
+		auto keygen = make_keygen(seed + readers);
+		while (!done.load()) {
+			insert(container, keygen(), writes++);
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}};
+
+	std::vector<std::thread> threads{};
+	auto start = std::chrono::high_resolution_clock::now();
+	for (std::size_t t = 0; t < readers; ++t) {
+		threads.emplace_back([&, t]() {
+			auto keygen = make_keygen(seed + t);
+			std::size_t h = 0;
+			for (std::size_t i = t; i < searches; i += readers) {
+				h += find(container, keygen());
+			}
+			hits += h;
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end - start;
+	done = true;
+	writer.join();
+
+	std::cout << method << " " << readers << " reader threads: " << searches << " random searches: " << elapsed.count()
+		<< " (" << searches / elapsed.count() << " searches/s)" << " writes: " << writes << " (hits " << hits << ")" << std::endl;
+}
+
 template<typename T, typename ActualComparator=std::less<T>>
 struct counting_comparator {
 	mutable std::size_t comparisons = 0;
@@ -89,31 +551,192 @@ struct counting_comparator {
 		++comparisons;
 		return comparator(lhs, rhs);
 	}
+
+	//only for three-way comparators
+	template<typename C = ActualComparator>
+	auto compare(const T& lhs, const T& rhs) const noexcept -> decltype(std::declval<const C&>().compare(lhs, rhs)) {
+		++comparisons;
+		return comparator.compare(lhs, rhs);
+	}
 };
 
+//insertions of keys (in this order, mapped to their indexes), searches of the found ones and an in-order scan of a map,
+//reporting the bytes allocated by the insertions (hence excluding the allocator's own overhead)
+template<typename A, typename K>
+void profile_map(A& container, const std::vector<K>& keys, const std::vector<K>& found, const std::string& method) {
+	auto allocs = allocations.load();
+	auto bytes = allocated_bytes.load();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (std::size_t i = 0; i < keys.size(); ++i) {
+		container[keys[i]] = i;
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> insert_elapsed = end - start;
+	bytes = allocated_bytes - bytes;
+	allocs = allocations - allocs;
+
+	std::size_t hits = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (const auto& k : found) {
+		hits += container.find(k) != container.end();
+	}
+	end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> search_elapsed = end - start;
+
+	std::size_t sum = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (const auto& p : container) {
+		sum += p.second;
+	}
+	end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> scan_elapsed = end - start;
+
+	std::cout << container.size() << " " << method << ": insertions took " << insert_elapsed.count()
+		<< " (" << insert_elapsed.count() * 1e9 / keys.size() << " ns/insertion) bytes: " << bytes
+		<< " (" << double(bytes) / container.size() << " per element) allocations: " << allocs << std::endl;
+	std::cout << found.size() << " " << method << ": searches took " << search_elapsed.count()
+		<< " (" << search_elapsed.count() * 1e9 / found.size() << " ns/search) (hits " << hits << ")" << std::endl;
+	std::cout << container.size() << " " << method << ": scan took " << scan_elapsed.count()
+		<< " (" << scan_elapsed.count() * 1e9 / container.size() << " ns/element) (sum " << sum << ")" << std::endl;
+}
+
+//searches of keys (in this order) timed as a whole, rather than one by one as in profile_find, with the comparisons
+//and the last level cache misses they cause
+template<typename A, typename K>
+void profile_descent(const A& container, const std::vector<K>& keys, const std::string& method) {
+	cache_miss_counter misses{};
+	std::size_t hits = 0;
+	auto comp = container.key_comp();
+	misses.start();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (const auto& k : keys) {
+		hits += container.find(k) != container.end();
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	auto cache_misses = misses.stop();
+	auto comp2 = container.key_comp();
+	std::chrono::duration<double> elapsed = end - start;
+
+	std::cout << keys.size() << " " << method << ": " << elapsed.count() << " (" << elapsed.count() * 1e9 / keys.size() << " ns/search)"
+		<< " comparisons total: " << comp2.comparisons - comp.comparisons << " LLC misses: ";
+	if (misses.available()) {
+		std::cout << cache_misses << " (" << double(cache_misses) / keys.size() << " per search)";
+	} else {
+		std::cout << "unavailable";
+	}
+	std::cout << " (hits " << hits << ")" << std::endl;
+}
+
+//insertions and searches on red_black bsts with keys of N words, only the last of which is random (as in main),
+//through std::less and through three_way_less
+template<std::size_t N>
+void profile_three_way(std::size_t size, std::size_t searches, std::size_t seed_insert, std::size_t seed_search) {
+	using K = std::array<std::size_t, N>;
+	std::mt19937 engine{};
+	std::uniform_int_distribution<std::size_t> dist{};
+	auto keygen = [&dist, &engine]() -> auto {
+		K k{0};
+		k[N - 1] = dist(engine);
+		return k;
+	};
+
+	bst<K, std::size_t, counting_comparator<K>, red_black> tree{};
+	engine.seed(seed_insert);
+	std::cout << "size_t[" << N << "] bst_rb ";
+	profile_insertions(tree, keygen, size);
+	engine.seed(seed_search);
+	std::cout << "size_t[" << N << "] bst_rb ";
+	profile_find(tree, keygen, searches);
+	tree.clear();
+
+	bst<K, std::size_t, counting_comparator<K, three_way_less<K>>, red_black> tree_three_way{};
+	engine.seed(seed_insert);
+	std::cout << "size_t[" << N << "] bst_rb three-way ";
+	profile_insertions(tree_three_way, keygen, size);
+	engine.seed(seed_search);
+	std::cout << "size_t[" << N << "] bst_rb three-way ";
+	profile_find(tree_three_way, keygen, searches);
+}
+
+//insertions, searches and a scan with keys of N words, on red_black bsts comparing whole keys and on a prefix_bst,
+//which stores each distinct prefix (the first N - 1 words) once and compares the last word alone: the prefixes are drawn
+//from a pool of the given size (1 gives the constant prefix of main's keys, size about one prefix per element)
+template<std::size_t N>
+void profile_prefix(std::size_t size, std::size_t searches, std::size_t seed_insert, std::size_t seed_search, std::size_t prefixes) {
+	using K = std::array<std::size_t, N>;
+	std::mt19937 engine{};
+	std::uniform_int_distribution<std::size_t> dist{};
+	auto keygen = [&dist, &engine, prefixes]() -> auto {
+		K k{0};
+		//prefixes differ from their first word on
+		auto prefix = dist(engine) % prefixes;
+		for (std::size_t i = 0; i < N - 1; ++i) {
+			k[i] = prefix * (i + 1);
+		}
+		k[N - 1] = dist(engine);
+		return k;
+	};
+
+	std::vector<K> keys{};
+	engine.seed(seed_insert);
+	for (std::size_t i = 0; i < size; ++i) {
+		keys.push_back(keygen());
+	}
+	//every other search is for a present key
+	std::vector<K> found{};
+	engine.seed(seed_search);
+	for (std::size_t i = 0; i < searches; ++i) {
+		found.push_back(i % 2 ? keygen() : keys[dist(engine) % keys.size()]);
+	}
+
+	const auto words = "size_t[" + std::to_string(N) + "] (" + std::to_string(prefixes) + " prefixes) ";
+	{
+		bst<K, std::size_t, std::less<K>, red_black> tree{};
+		profile_map(tree, keys, found, words + "bst_rb");
+	}
+	{
+		bst<K, std::size_t, three_way_less<K>, red_black> tree_three_way{};
+		profile_map(tree_three_way, keys, found, words + "bst_rb three-way");
+	}
+	{
+		prefix_bst<std::size_t, N, std::size_t> tree_prefix{};
+		profile_map(tree_prefix, keys, found, words + "prefix_bst");
+		std::cout << words << "prefix_bst groups: " << tree_prefix.prefixes() << std::endl;
+	}
+}
+
 int main(int argc, char** argv) {
 	std::size_t seed_insert = 123543;
 	std::size_t seed_search = 874563;
 
 	std::size_t size = 1000000;
 	std::size_t searches = 1000000;
+	std::size_t range_width = 100;
 
 	std::string container_type{"bst"};
 	int param = 0;
 	if (argc > ++param) {
 		container_type = argv[param];
 
-		if (container_type != "stdmap" && container_type != "bst" && container_type != "bst_unbalanced") {
-			std::cerr << "first parameter must be either be stdmap or bst" << std::endl;
+		if (container_type != "stdmap" && container_type != "bst" && container_type != "bst_unbalanced"
+			&& container_type != "bst_rb" && container_type != "bst_avl" && container_type != "bst_arena" && container_type != "bst_frozen"
+			&& container_type != "bst_batch" && container_type != "bst_bulk" && container_type != "bst_hint"
+			&& container_type != "bst_heavy" && container_type != "bst_churn" && container_type != "bst_range"
+			&& container_type != "bst_reverse" && container_type != "bst_percentile" && container_type != "bst_concurrent"
+			&& container_type != "bst_copy" && container_type != "bst_mapped" && container_type != "bst_dump"
+			&& container_type != "bst_merge" && container_type != "bst_string" && container_type != "bst_three_way"
+			&& container_type != "btree" && container_type != "bst_prefix" && container_type != "bst_prefetch") {
+			std::cerr << "first parameter must be either be stdmap, bst, bst_unbalanced, bst_rb, bst_avl, bst_arena, bst_frozen, bst_batch, bst_bulk, bst_hint, bst_heavy, bst_churn, bst_range, bst_reverse, bst_percentile, bst_concurrent, bst_copy, bst_mapped, bst_dump, bst_merge, bst_string, bst_three_way, btree, bst_prefix or bst_prefetch" << std::endl;
 			exit(EXIT_FAILURE);
 		}
 	} else {
 		std::cerr << "performs random (from a uniform distribution) insertions and lookups in the given container type, monitoring time spent and comparisons performed" << std::endl;
-		std::cerr << "usage: " << argv[0] << " stdmap|bst|bst_unbalanced"
+		std::cerr << "usage: " << argv[0] << " stdmap|bst|bst_unbalanced|bst_rb|bst_avl|bst_arena|bst_frozen|bst_batch|bst_bulk|bst_hint|bst_heavy|bst_churn|bst_range|bst_reverse|bst_percentile|bst_concurrent|bst_copy|bst_mapped|bst_dump|bst_merge|bst_string|bst_three_way|btree|bst_prefix|bst_prefetch"
 			<< " (#random_insertions default: " << size
 			<< ") (#searches default: " << searches
 			<< ") (seed_insert default: " << seed_insert
 			<< ") (seed_search default: " << seed_search
+			<< ") (range_width default: " << range_width
 			<< ")" << std::endl;
 		exit(EXIT_FAILURE);
 	}
@@ -153,6 +776,15 @@ int main(int argc, char** argv) {
 			exit(EXIT_FAILURE);
 		}
 	}
+	if (argc > ++param) {
+		std::size_t pos;
+		range_width = std::stoull(argv[param], &pos);
+
+		if (!pos) {
+			std::cerr << "sixth parameter must be a positive integer for the average number of elements in the ranges of bst_range and bst_reverse" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
 
 	#ifndef KEY_SIZE
 	#define KEY_SIZE 1
@@ -168,14 +800,16 @@ int main(int argc, char** argv) {
 
 	std::map<K, std::size_t, counting_comparator<K>> stdmap{};
 	bst<K, std::size_t, counting_comparator<K>> tree_unbalanced{};
-	bool do_balanced = container_type != "bst_unbalanced";
+	bst<K, std::size_t, counting_comparator<K>, red_black> tree_rb{};
+	bst<K, std::size_t, counting_comparator<K>, avl> tree_avl{};
+	bst<K, std::size_t, counting_comparator<K>, no_balancing, arena_allocator<std::pair<const K, std::size_t>>> tree_arena{};
+	bool do_balanced = container_type == "bst" || container_type == "bst_batch";
 
 	std::cout << "test " << container_type << " with keys size_t[" << std::tuple_size<K>::value << "] (uniform distribution)" << std::endl;
 	std::cout << "insert seed " << seed_insert << " search seed " << seed_search << std::endl;
-	std::cout << "nodes will use " << (double) (sizeof(node<std::pair<const K, std::size_t>>) * size) / (1000 * 1000 * 1000) << " GB" << std::endl;
-	if (container_type == "bst") {
-		std::cout << "balancing will use " << (double) (sizeof(std::pair<const K, std::size_t>) * size) / (1000 * 1000 * 1000) << " GB" << std::endl;
-	}
+	using node_type = typename decltype(tree_unbalanced)::node_type;
+	std::cout << "nodes will use " << (double) (sizeof(node_type) * size) / (1000 * 1000 * 1000) << " GB"
+		<< " (" << sizeof(node_type) << " bytes/node for a " << sizeof(std::pair<const K, std::size_t>) << " bytes payload)" << std::endl;
 
 	std::cout << std::endl;
 	std::cout << "size: " << size << std::endl;
@@ -184,11 +818,638 @@ int main(int argc, char** argv) {
 	if (container_type == "stdmap") {
 		std::cout << "stdmap ";
 		profile_insertions(stdmap, keygen, size);
+	} else if (container_type == "bst_rb") {
+		std::cout << "bst_rb ";
+		profile_insertions(tree_rb, keygen, size);
+
+		std::cout << "bst_rb shape " << tree_rb.shape_stats() << std::endl;
+	} else if (container_type == "bst_avl") {
+		std::cout << "bst_avl ";
+		profile_insertions(tree_avl, keygen, size);
+
+		std::cout << "bst_avl shape " << tree_avl.shape_stats() << std::endl;
+	} else if (container_type == "bst_arena") {
+		std::cout << "bst_arena ";
+		profile_insertions(tree_arena, keygen, size);
+
+		std::cout << "bst_arena shape " << tree_arena.shape_stats() << std::endl;
+		std::cout << "bst_arena blocks " << tree_arena.get_allocator().block_count() << std::endl;
+	} else if (container_type == "bst_bulk") {
+		std::vector<std::pair<K, std::size_t>> sorted{};
+		sorted.reserve(size);
+		for (std::size_t i = 0; i < size; ++i) {
+			sorted.emplace_back(keygen(), i);
+		}
+		std::sort(sorted.begin(), sorted.end());
+		sorted.erase(std::unique(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) { return lhs.first == rhs.first; }), sorted.end());
+
+		//the unbalanced bst would degenerate into a list with sorted insertions, so the red_black one is used
+		std::cout << "bst_rb ";
+		profile_load(tree_rb, sorted, [](auto& tree, const auto& pairs) {
+			for (const auto& p : pairs) {
+				tree.insert(p);
+			}
+		}, "sorted insertions");
+
+		std::cout << "stdmap ";
+		profile_load(stdmap, sorted, [](auto& map, const auto& pairs) {
+			for (const auto& p : pairs) {
+				map.insert(map.end(), p);
+			}
+		}, "sorted hinted insertions");
+
+		std::cout << "bst_bulk ";
+		profile_load(tree_unbalanced, sorted, [](auto& tree, const auto& pairs) {
+			tree.assign_sorted(pairs.begin(), pairs.end());
+		}, "sorted bulk load");
+
+		std::cout << "bst_bulk shape " << tree_unbalanced.shape_stats() << std::endl;
+	} else if (container_type == "bst_hint") {
+		//sequential keys, then the same keys where each one is swapped with one of the following 8
+		std::vector<std::pair<K, std::size_t>> sequential{};
+		sequential.reserve(size);
+		for (std::size_t i = 0; i < size; ++i) {
+			K k{0};
+			k[std::tuple_size<K>::value - 1] = i;
+			sequential.emplace_back(k, i);
+		}
+		auto nearly_sorted = sequential;
+		for (std::size_t i = 0; i + 1 < size; ++i) {
+			std::swap(nearly_sorted[i], nearly_sorted[i + 1 + dist(engine) % std::min<std::size_t>(8, size - i - 1)]);
+		}
+
+		auto insert = [](auto& container, const auto& pairs) {
+			for (const auto& p : pairs) {
+				container.insert(p);
+			}
+		};
+		auto insert_hinted = [](auto& container, const auto& pairs) {
+			auto hint = container.end();
+			for (const auto& p : pairs) {
+				hint = container.insert(hint, p);
+			}
+		};
+
+		for (const auto* pairs : {&sequential, &nearly_sorted}) {
+			std::string keys{pairs == &sequential ? "sequential" : "nearly sorted"};
+
+			std::cout << "bst_rb ";
+			profile_load(tree_rb, *pairs, insert, keys + " insertions");
+			tree_rb.clear();
+
+			std::cout << "bst_rb ";
+			profile_load(tree_rb, *pairs, insert_hinted, keys + " hinted insertions");
+			tree_rb.clear();
+
+			std::cout << "stdmap ";
+			profile_load(stdmap, *pairs, insert_hinted, keys + " hinted insertions");
+			stdmap.clear();
+		}
+
+		//the searches are performed on a red_black bst
+		std::cout << "bst_rb ";
+		profile_load(tree_rb, nearly_sorted, insert_hinted, "nearly sorted hinted insertions");
+		std::cout << "bst_rb shape " << tree_rb.shape_stats() << std::endl;
+		container_type = "bst_rb";
+	} else if (container_type == "bst_heavy") {
+		std::map<K, heavy_value, counting_comparator<K>> stdmap_heavy{};
+		bst<K, heavy_value, counting_comparator<K>> tree_heavy{};
+
+		auto brackets = [](auto& container, const K& k, std::size_t i) {
+			container[k].payload[0] = i;
+		};
+		auto emplace = [](auto& container, const K& k, std::size_t) {
+			container.emplace(k, heavy_value{});
+		};
+		auto try_emplace = [](auto& container, const K& k, std::size_t) {
+			container.try_emplace(k);
+		};
+
+		//the first round inserts, the following ones only hit existing keys
+		engine.seed(seed_insert);
+		std::cout << "stdmap ";
+		profile_heavy(stdmap_heavy, keygen, size, brackets, "operator[] insertions");
+		engine.seed(seed_insert);
+		std::cout << "bst_heavy ";
+		profile_heavy(tree_heavy, keygen, size, brackets, "operator[] insertions");
+
+		engine.seed(seed_insert);
+		std::cout << "stdmap ";
+		profile_heavy(stdmap_heavy, keygen, size, brackets, "operator[] hits");
+		engine.seed(seed_insert);
+		std::cout << "bst_heavy ";
+		profile_heavy(tree_heavy, keygen, size, brackets, "operator[] hits");
+
+		engine.seed(seed_insert);
+		std::cout << "stdmap ";
+		profile_heavy(stdmap_heavy, keygen, size, emplace, "emplace hits");
+		engine.seed(seed_insert);
+		std::cout << "bst_heavy ";
+		profile_heavy(tree_heavy, keygen, size, emplace, "emplace hits");
+
+		engine.seed(seed_insert);
+		std::cout << "stdmap ";
+		profile_heavy(stdmap_heavy, keygen, size, try_emplace, "try_emplace hits");
+		engine.seed(seed_insert);
+		std::cout << "bst_heavy ";
+		profile_heavy(tree_heavy, keygen, size, try_emplace, "try_emplace hits");
+
+		//the search and clear phases below measure the size_t valued trees
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_churn") {
+		//keys out of twice the size, so that the churn keeps the size stable
+		std::uniform_int_distribution<std::size_t> churn_dist{0, 2 * size};
+		auto churn_keygen = [&churn_dist, &engine]() -> auto {
+			K k{0};
+			k[std::tuple_size<K>::value - 1] = churn_dist(engine);
+			return k;
+		};
+
+		engine.seed(seed_insert);
+		std::cout << "stdmap ";
+		profile_insertions(stdmap, churn_keygen, size);
+		engine.seed(seed_search);
+		std::cout << "stdmap ";
+		profile_churn(stdmap, churn_keygen, searches);
+
+		engine.seed(seed_insert);
+		std::cout << "bst_unbalanced ";
+		profile_insertions(tree_unbalanced, churn_keygen, size);
+		engine.seed(seed_search);
+		std::cout << "bst_unbalanced ";
+		profile_churn(tree_unbalanced, churn_keygen, searches);
+		std::cout << "bst_unbalanced shape " << tree_unbalanced.shape_stats() << std::endl;
+
+		engine.seed(seed_insert);
+		std::cout << "bst_rb ";
+		profile_insertions(tree_rb, churn_keygen, size);
+		engine.seed(seed_search);
+		std::cout << "bst_rb ";
+		profile_churn(tree_rb, churn_keygen, searches);
+		std::cout << "bst_rb shape " << tree_rb.shape_stats() << std::endl;
+
+		engine.seed(seed_insert);
+		std::cout << "bst_avl ";
+		profile_insertions(tree_avl, churn_keygen, size);
+		engine.seed(seed_search);
+		std::cout << "bst_avl ";
+		profile_churn(tree_avl, churn_keygen, searches);
+		std::cout << "bst_avl shape " << tree_avl.shape_stats() << std::endl;
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_range") {
+		engine.seed(seed_insert);
+		std::cout << "stdmap ";
+		profile_insertions(stdmap, keygen, size);
+		engine.seed(seed_insert);
+		std::cout << "bst_rb ";
+		profile_insertions(tree_rb, keygen, size);
+
+		auto step = dist.max() / size;
+		auto scan_bounds = [](const auto& container, const K& lo, const K& hi) -> std::size_t {
+			std::size_t count = 0;
+			for (auto iter = container.lower_bound(lo), last = container.lower_bound(hi); iter != last; ++iter) {
+				count += iter->second != std::size_t(-1);
+			}
+			return count;
+		};
+		auto scan_range = [](const auto& container, const K& lo, const K& hi) -> std::size_t {
+			std::size_t count = 0;
+			for (const auto& p : container.range(lo, hi)) {
+				count += p.second != std::size_t(-1);
+			}
+			return count;
+		};
+
+		engine.seed(seed_search);
+		std::cout << "stdmap ";
+		profile_range(stdmap, keygen, searches, range_width, step, scan_bounds, "lower_bound scans");
+		engine.seed(seed_search);
+		std::cout << "bst_rb ";
+		profile_range(tree_rb, keygen, searches, range_width, step, scan_bounds, "lower_bound scans");
+		engine.seed(seed_search);
+		std::cout << "bst_rb ";
+		profile_range(tree_rb, keygen, searches, range_width, step, scan_range, "range scans");
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_reverse") {
+		engine.seed(seed_insert);
+		std::cout << "stdmap ";
+		profile_insertions(stdmap, keygen, size);
+		engine.seed(seed_insert);
+		std::cout << "bst_rb ";
+		profile_insertions(tree_rb, keygen, size);
+
+		//the range_width elements up to hi, latest first
+		auto scan_reverse = [range_width](const auto& container, const K&, const K& hi) -> std::size_t {
+			std::size_t count = 0;
+			auto last = std::make_reverse_iterator(container.lower_bound(hi));
+			for (auto iter = last; iter != container.rend() && count != range_width; ++iter) {
+				count += iter->second != std::size_t(-1);
+			}
+			return count;
+		};
+
+		engine.seed(seed_search);
+		std::cout << "stdmap ";
+		profile_range(stdmap, keygen, searches, range_width, 0, scan_reverse, "reverse scans");
+		engine.seed(seed_search);
+		std::cout << "bst_rb ";
+		profile_range(tree_rb, keygen, searches, range_width, 0, scan_reverse, "reverse scans");
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_percentile") {
+		bst<K, std::size_t, counting_comparator<K>, order_statistics<red_black>> tree_os{};
+		std::cout << "order statistics nodes use " << sizeof(typename decltype(tree_os)::node_type) << " bytes/node" << std::endl;
+
+		engine.seed(seed_insert);
+		std::cout << "stdmap ";
+		profile_insertions(stdmap, keygen, size);
+		engine.seed(seed_insert);
+		std::cout << "bst_rb ";
+		profile_insertions(tree_rb, keygen, size);
+		engine.seed(seed_insert);
+		std::cout << "bst_os ";
+		profile_insertions(tree_os, keygen, size);
+		std::cout << "bst_os shape " << tree_os.shape_stats() << std::endl;
+
+		//walking the sequence is linear: the plain containers answer a hundred thousandth of the queries
+		auto linear_searches = std::max<std::size_t>(searches / 100000, 1);
+		auto linear_select = [](const auto& container, std::size_t k) {
+			return std::next(container.begin(), k);
+		};
+		auto linear_rank = [](const auto& container, const K& key) -> std::size_t {
+			return std::distance(container.begin(), container.lower_bound(key));
+		};
+		engine.seed(seed_search);
+		std::cout << "stdmap ";
+		profile_percentiles(stdmap, keygen, linear_searches, linear_select, linear_rank, "linear");
+		engine.seed(seed_search);
+		std::cout << "bst_rb ";
+		profile_percentiles(tree_rb, keygen, linear_searches, linear_select, linear_rank, "linear");
+
+		engine.seed(seed_search);
+		std::cout << "bst_os ";
+		profile_percentiles(tree_os, keygen, searches,
+			[](const auto& container, std::size_t k) { return container.nth(k); },
+			[](const auto& container, const K& key) { return container.rank(key); }, "nth/rank");
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_concurrent") {
+		//counting_comparator is not thread-safe
+		bst<K, std::size_t, std::less<K>, red_black> tree{};
+		engine.seed(seed_insert);
+		for (std::size_t i = 0; tree.size() != size; ++i) {
+			tree[keygen()] = i;
+		}
+		std::cout << "bst_rb shape " << tree.shape_stats() << std::endl;
+
+		std::mutex tree_mutex;
+		concurrent_bst<K, std::size_t, std::less<K>, red_black> concurrent_tree{tree};
+		std::size_t max_readers = std::max(std::thread::hardware_concurrency(), 1u);
+		for (std::size_t readers = 1; ; readers = std::min(2 * readers, max_readers)) {
+			profile_threads<K>(tree, readers, searches, seed_search,
+				[&tree_mutex](const auto& container, const K& key) {
+					std::lock_guard<std::mutex> lock{tree_mutex};
+					return container.find(key) != container.end();
+				},
+				[&tree_mutex](auto& container, const K& key, std::size_t i) {
+					std::lock_guard<std::mutex> lock{tree_mutex};
+					container.insert(std::make_pair(key, i));
+				}, "bst_rb with mutex");
+			profile_threads<K>(concurrent_tree, readers, searches, seed_search,
+				[](const auto& container, const K& key) {
+					return container.contains(key);
+				},
+				[](auto& container, const K& key, std::size_t i) {
+					container.insert(std::make_pair(key, i));
+				}, "concurrent_bst");
+
+			if (readers == max_readers) {
+				break;
+			}
+		}
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_mapped") {
+		//startup from the source data, through insertions, against startup from a file saved beforehand
+		engine.seed(seed_insert);
+		std::cout << "bst_rb ";
+		profile_insertions(tree_rb, keygen, size);
+
+		const std::string path{"profile_bst_mapped.bin"};
+		using mapped_type = mapped_bst<K, std::size_t, counting_comparator<K>>;
+		auto start = std::chrono::high_resolution_clock::now();
+		mapped_type::save(tree_rb, path);
+		auto end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed = end - start;
+		std::cout << "bst_rb save took " << elapsed.count() << std::endl;
+
+		start = std::chrono::high_resolution_clock::now();
+		mapped_type mapped{path};
+		end = std::chrono::high_resolution_clock::now();
+		elapsed = end - start;
+		std::cout << "bst_mapped opening " << mapped.size() << " elements took " << elapsed.count() << std::endl;
+
+		//the file is still in the page cache: the first searches do not wait for the disk
+		engine.seed(seed_search);
+		std::cout << "bst_mapped ";
+		profile_find(mapped, keygen, searches);
+
+		decltype(tree_rb) loaded{};
+		std::cout << "bst_rb ";
+		profile_load(loaded, mapped, [](auto& tree, const auto& pairs) {
+			tree = std::decay_t<decltype(tree)>{sorted_unique, pairs.begin(), pairs.end()};
+		}, "mapped elements loaded");
+		std::cout << "bst_rb shape " << loaded.shape_stats() << std::endl;
+
+		engine.seed(seed_search);
+		std::cout << "bst_rb ";
+		profile_find(loaded, keygen, searches);
+
+		std::remove(path.c_str());
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_dump") {
+		//arithmetic keys, which operator<< can print too
+		bst<std::size_t, std::size_t, std::less<std::size_t>, red_black> tree{};
+		engine.seed(seed_insert);
+		for (std::size_t i = 0; tree.size() != size; ++i) {
+			tree[dist(engine)] = i;
+		}
+
+		//the nodes are scattered in memory, so that the walk alone is a large part of any export
+		std::size_t checksum = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (const auto& p : tree) {
+			checksum += p.first ^ p.second;
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed = end - start;
+		std::cout << tree.size() << " elements iteration only: " << elapsed.count() << " (" << elapsed.count() * 1e9 / tree.size()
+			<< " ns/element) checksum: " << checksum << std::endl;
+
+		const std::string path{"profile_bst_dump.txt"};
+		profile_dump(tree, path, [](const auto& tree, const std::string& path) {
+			std::ofstream file{path};
+			file << tree;
+			return static_cast<std::size_t>(file.tellp());
+		}, "operator<< to ofstream");
+		profile_dump(tree, path, [](const auto& tree, const std::string& path) {
+			std::ofstream file{path};
+			tree.dump(file);
+			return static_cast<std::size_t>(file.tellp());
+		}, "dump to ofstream");
+		profile_dump(tree, path, [](const auto& tree, const std::string& path) {
+			std::size_t bytes = 0;
+			auto file = std::fopen(path.c_str(), "w");
+			std::vector<char> buffer(1 << 20);
+			tree.dump([file, &bytes](const char* data, std::size_t size) {
+				bytes += std::fwrite(data, 1, size, file);
+			}, buffer.data(), buffer.size());
+			std::fclose(file);
+			return bytes;
+		}, "dump to FILE with 1MiB chunks");
+		profile_dump(tree, path, [](const auto& tree, const std::string&) {
+			std::size_t bytes = 0;
+			std::vector<char> buffer(1 << 20);
+			tree.dump([&bytes](const char*, std::size_t size) {
+				bytes += size;
+			}, buffer.data(), buffer.size());
+			return bytes;
+		}, "dump formatting only");
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_merge") {
+		//two sets of random keys (from the insertion and the search seeds) out of twice the size, so that about half
+		//of the keys of each are in the other
+		std::uniform_int_distribution<std::size_t> merge_dist{0, 2 * size};
+		auto merge_keygen = [&merge_dist, &engine]() -> auto {
+			K k{0};
+			k[std::tuple_size<K>::value - 1] = merge_dist(engine);
+			return k;
+		};
+		decltype(stdmap) other_stdmap{};
+		decltype(tree_rb) other_tree_rb{};
+		engine.seed(seed_insert);
+		std::cout << "stdmap ";
+		profile_insertions(stdmap, merge_keygen, size);
+		engine.seed(seed_search);
+		std::cout << "stdmap ";
+		profile_insertions(other_stdmap, merge_keygen, size);
+		engine.seed(seed_insert);
+		std::cout << "bst_rb ";
+		profile_insertions(tree_rb, merge_keygen, size);
+		engine.seed(seed_search);
+		std::cout << "bst_rb ";
+		profile_insertions(other_tree_rb, merge_keygen, size);
+
+		std::cout << "stdmap ";
+		profile_set_operation(stdmap, other_stdmap, [](auto& lhs, auto& rhs) {
+			lhs.merge(rhs);
+		}, "merge");
+		std::cout << "bst_rb ";
+		profile_set_operation(tree_rb, other_tree_rb, [](auto& lhs, auto& rhs) {
+			for (const auto& p : rhs) {
+				lhs.insert(p);
+			}
+		}, "insertions");
+		std::cout << "bst_rb ";
+		profile_set_operation(tree_rb, other_tree_rb, [](auto& lhs, auto& rhs) {
+			lhs.merge(rhs);
+		}, "merge");
+		std::cout << "bst_rb ";
+		profile_set_operation(tree_rb, other_tree_rb, [](auto& lhs, const auto& rhs) {
+			lhs.union_with(rhs);
+		}, "union_with");
+		std::cout << "bst_rb ";
+		profile_set_operation(tree_rb, other_tree_rb, [](auto& lhs, const auto& rhs) {
+			lhs.intersect_with(rhs);
+		}, "intersect_with");
+		std::cout << "bst_rb ";
+		profile_set_operation(tree_rb, other_tree_rb, [](auto& lhs, const auto& rhs) {
+			lhs.difference(rhs);
+		}, "difference");
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_string") {
+		//string keys longer than the small string buffer, so that each std::string built for a search allocates
+		auto to_key = [](std::size_t k) {
+			auto digits = std::to_string(k);
+			return "profile key " + std::string(20 - digits.size(), '0') + digits;
+		};
+
+		std::map<std::string, std::size_t, std::less<>> stdmap_string{};
+		bst<std::string, std::size_t, std::less<std::string>, red_black> tree_string{};
+		bst<std::string, std::size_t, std::less<>, red_black> tree_transparent{};
+		std::vector<std::string> inserted{};
+		engine.seed(seed_insert);
+		for (std::size_t i = 0; tree_string.size() != size; ++i) {
+			inserted.push_back(to_key(dist(engine)));
+			stdmap_string[inserted.back()] = i;
+			tree_transparent[inserted.back()] = i;
+			tree_string[inserted.back()] = i;
+		}
+
+		//the searched keys are views on one buffer, as if parsed from a request
+		engine.seed(seed_search);
+		std::vector<std::size_t> offsets{};
+		std::string buffer{};
+		for (std::size_t i = 0; i < searches; ++i) {
+			offsets.push_back(buffer.size());
+			//every other key is present
+			buffer += i % 2 ? to_key(dist(engine)) : inserted[dist(engine) % inserted.size()];
+		}
+		offsets.push_back(buffer.size());
+		std::vector<std::string_view> keys{};
+		for (std::size_t i = 0; i < searches; ++i) {
+			keys.emplace_back(buffer.data() + offsets[i], offsets[i + 1] - offsets[i]);
+		}
+
+		std::cout << "bst_rb ";
+		profile_lookups(tree_string, keys, [](const auto& tree, std::string_view key) {
+			return tree.find(std::string{key});
+		}, "searches through a std::string");
+		std::cout << "bst_rb ";
+		profile_lookups(tree_transparent, keys, [](const auto& tree, std::string_view key) {
+			return tree.find(key);
+		}, "transparent searches");
+		std::cout << "stdmap ";
+		profile_lookups(stdmap_string, keys, [](const auto& map, std::string_view key) {
+			return map.find(key);
+		}, "transparent searches");
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_three_way") {
+		//the key sizes are fixed here, rather than by KEY_SIZE
+		profile_three_way<1>(size, searches, seed_insert, seed_search);
+		profile_three_way<2>(size, searches, seed_insert, seed_search);
+		profile_three_way<4>(size, searches, seed_insert, seed_search);
+		profile_three_way<8>(size, searches, seed_insert, seed_search);
+		profile_three_way<16>(size, searches, seed_insert, seed_search);
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "btree") {
+		//plain integer keys (regardless of KEY_SIZE), which btree compares a vector at a time
+		std::vector<std::size_t> keys{};
+		engine.seed(seed_insert);
+		for (std::size_t i = 0; i < size; ++i) {
+			keys.push_back(dist(engine));
+		}
+		//every other search is for a present key
+		std::vector<std::size_t> found{};
+		engine.seed(seed_search);
+		for (std::size_t i = 0; i < searches; ++i) {
+			found.push_back(i % 2 ? dist(engine) : keys[dist(engine) % keys.size()]);
+		}
+
+		{
+			std::map<std::size_t, std::size_t> stdmap_integer{};
+			profile_map(stdmap_integer, keys, found, "stdmap");
+		}
+		{
+			bst<std::size_t, std::size_t, std::less<std::size_t>, red_black> tree_integer{};
+			profile_map(tree_integer, keys, found, "bst_rb");
+		}
+		{
+			btree<std::size_t, std::size_t> btree_integer{};
+			profile_map(btree_integer, keys, found, "btree");
+			std::cout << "btree depth " << btree_integer.depth() << std::endl;
+		}
+		{
+			//appended in order, which leaves the nodes full
+			std::sort(keys.begin(), keys.end());
+			btree<std::size_t, std::size_t> btree_sorted{};
+			profile_map(btree_sorted, keys, found, "btree (sorted insertions)");
+			std::cout << "btree depth " << btree_sorted.depth() << std::endl;
+		}
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_prefix") {
+		//the key sizes are fixed here, rather than by KEY_SIZE
+		//a constant prefix, a small pool of prefixes, and about as many prefixes as elements
+		for (auto prefixes : {std::size_t{1}, std::size_t{1000}, size}) {
+			profile_prefix<2>(size, searches, seed_insert, seed_search, prefixes);
+			profile_prefix<4>(size, searches, seed_insert, seed_search, prefixes);
+			profile_prefix<8>(size, searches, seed_insert, seed_search, prefixes);
+			profile_prefix<16>(size, searches, seed_insert, seed_search, prefixes);
+		}
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_prefetch") {
+		bst<K, std::size_t, counting_comparator<K>, prefetched_search<red_black>> tree_prefetched{};
+		std::vector<K> inserted{};
+		for (std::size_t i = 0; i < size; ++i) {
+			inserted.push_back(keygen());
+			tree_rb[inserted.back()] = i;
+			tree_prefetched[inserted.back()] = i;
+		}
+		//every other search is for a present key
+		std::vector<K> keys{};
+		engine.seed(seed_search);
+		for (std::size_t i = 0; i < searches; ++i) {
+			keys.push_back(i % 2 ? keygen() : inserted[dist(engine) % inserted.size()]);
+		}
+
+		std::cout << "bst_rb ";
+		profile_descent(tree_rb, keys, "searches");
+		std::cout << "bst_rb ";
+		profile_descent(tree_prefetched, keys, "prefetched searches");
+		std::sort(keys.begin(), keys.end());
+		std::cout << "bst_rb ";
+		profile_descent(tree_rb, keys, "sorted searches");
+		std::cout << "bst_rb ";
+		profile_descent(tree_prefetched, keys, "sorted prefetched searches");
+
+		return EXIT_SUCCESS;
+	} else if (container_type == "bst_copy") {
+		//sorted keys turn the unbalanced bsts into lists, as deep as they are large
+		std::vector<std::pair<K, std::size_t>> sequential{};
+		sequential.reserve(size);
+		for (std::size_t i = 0; i < size; ++i) {
+			K k{0};
+			k[std::tuple_size<K>::value - 1] = i;
+			sequential.emplace_back(k, i);
+		}
+
+		//appending at end() is constant time
+		auto append = [](auto& container, const auto& pairs) {
+			for (const auto& p : pairs) {
+				container.insert(container.end(), p);
+			}
+		};
+
+		std::cout << "stdmap ";
+		profile_load(stdmap, sequential, append, "sequential insertions at end");
+		std::cout << "stdmap ";
+		profile_copy(stdmap, "elements");
+		stdmap.clear();
+
+		std::cout << "bst_unbalanced ";
+		profile_load(tree_unbalanced, sequential, append, "sequential insertions at end");
+		std::cout << "bst_unbalanced depth " << tree_unbalanced.depth() << std::endl;
+		std::cout << "bst_unbalanced ";
+		profile_copy(tree_unbalanced, "elements");
+		tree_unbalanced.clear();
+
+		std::cout << "bst_rb ";
+		profile_load(tree_rb, sequential, append, "sequential insertions at end");
+		std::cout << "bst_rb shape " << tree_rb.shape_stats() << std::endl;
+		std::cout << "bst_rb ";
+		profile_copy(tree_rb, "elements");
+		tree_rb.clear();
+
+		std::cout << "bst_arena ";
+		profile_load(tree_arena, sequential, append, "sequential insertions at end");
+		std::cout << "bst_arena ";
+		profile_copy(tree_arena, "elements");
+
+		return EXIT_SUCCESS;
 	} else {
 		std::cout << "bst_unbalanced ";
 		profile_insertions(tree_unbalanced, keygen, size);
 
-		std::cout << "bst_unbalanced depth " << tree_unbalanced.depth() << std::endl;
+		std::cout << "bst_unbalanced shape " << tree_unbalanced.shape_stats() << std::endl;
 	}
 
 	engine.seed(seed_search);
@@ -196,6 +1457,18 @@ int main(int argc, char** argv) {
 
 		std::cout << "stdmap ";
 		profile_find(stdmap, keygen, searches);
+	} else if (container_type == "bst_rb") {
+		std::cout << "bst_rb ";
+		profile_find(tree_rb, keygen, searches);
+	} else if (container_type == "bst_avl") {
+		std::cout << "bst_avl ";
+		profile_find(tree_avl, keygen, searches);
+	} else if (container_type == "bst_arena") {
+		std::cout << "bst_arena ";
+		profile_find(tree_arena, keygen, searches);
+	} else if (container_type == "bst_bulk") {
+		std::cout << "bst_bulk ";
+		profile_find(tree_unbalanced, keygen, searches);
 	} else {
 		engine.seed(seed_search);
 
@@ -203,18 +1476,87 @@ int main(int argc, char** argv) {
 		profile_find(tree_unbalanced, keygen, searches);
 
 		if (do_balanced) {
+			//parallel copy and rebuild, from 1 to hardware_concurrency threads
+			std::size_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+			for (std::size_t threads = 1; ; threads = std::min(2 * threads, max_threads)) {
+				auto start = std::chrono::high_resolution_clock::now();
+				decltype(tree_unbalanced) copy{tree_unbalanced, threads};
+				auto middle = std::chrono::high_resolution_clock::now();
+				copy.balance(threads);
+				auto end = std::chrono::high_resolution_clock::now();
+				std::chrono::duration<double> copy_elapsed = middle - start;
+				std::chrono::duration<double> balance_elapsed = end - middle;
+				std::cout << "bst_unbalanced with " << threads << " threads: copy took " << copy_elapsed.count()
+					<< " balance took " << balance_elapsed.count() << std::endl;
+
+				if (threads == max_threads) {
+					break;
+				}
+			}
+
 			auto tree{tree_unbalanced};
 			std::cout << "balancing tree" << std::endl;
+			auto comp = tree.key_comp();
+			auto allocs = allocations.load();
 			auto start = std::chrono::high_resolution_clock::now();
 			tree.balance();
 			auto end = std::chrono::high_resolution_clock::now();
 			std::chrono::duration<double> elapsed = end - start;
-			std::cout << "bst_balanced depth " << tree.depth() << " took " << elapsed.count() << std::endl;
+			auto comp2 = tree.key_comp();
+			std::cout << "bst_balanced depth " << tree.depth() << " took " << elapsed.count()
+				<< " comparisons: " << comp2.comparisons - comp.comparisons << " allocations: " << allocations - allocs << std::endl;
+			std::cout << "bst_balanced shape " << tree.shape_stats() << std::endl;
 
 			engine.seed(seed_search);
 
 			std::cout << "bst_balanced ";
 			profile_find(tree, keygen, searches);
+
+			if (container_type == "bst_batch") {
+				engine.seed(seed_search);
+
+				std::cout << "bst_balanced ";
+				profile_find_many(tree, keygen, searches, false);
+
+				engine.seed(seed_search);
+
+				std::cout << "bst_balanced ";
+				profile_find_many(tree, keygen, searches, true);
+			}
+		}
+
+		if (container_type == "bst_frozen") {
+			std::cout << "freezing tree" << std::endl;
+			auto start = std::chrono::high_resolution_clock::now();
+			frozen_bst<K, std::size_t, counting_comparator<K>> frozen{tree_unbalanced};
+			auto end = std::chrono::high_resolution_clock::now();
+			std::chrono::duration<double> elapsed = end - start;
+			std::cout << "bst_frozen took " << elapsed.count() << std::endl;
+
+			engine.seed(seed_search);
+
+			std::cout << "bst_frozen ";
+			profile_find(frozen, keygen, searches);
 		}
 	}
+
+	if (container_type == "stdmap") {
+		std::cout << "stdmap ";
+		profile_clear(stdmap);
+	} else if (container_type == "bst_rb") {
+		std::cout << "bst_rb ";
+		profile_clear(tree_rb);
+	} else if (container_type == "bst_avl") {
+		std::cout << "bst_avl ";
+		profile_clear(tree_avl);
+	} else if (container_type == "bst_arena") {
+		std::cout << "bst_arena ";
+		profile_clear(tree_arena);
+	} else if (container_type == "bst_bulk") {
+		std::cout << "bst_bulk ";
+		profile_clear(tree_unbalanced);
+	} else {
+		std::cout << "bst_unbalanced ";
+		profile_clear(tree_unbalanced);
+	}
 }
@@ -1,8 +1,18 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <iterator>
+#include <thread>
+#include <cstdio>
 
 #include "bst.hpp"
+#include "frozen_bst.hpp"
+#include "concurrent_bst.hpp"
+#include "mapped_bst.hpp"
+#include "btree.hpp"
+#include "prefix_bst.hpp"
 
 template<typename K, typename V>
 std::ostream& operator<<(std::ostream& os, const std::map<K, V>& m) {
@@ -125,6 +135,18 @@ int main() {
 	std::cout << std::endl;
 	std::cout << "copy-assigned:" << std::endl;
 	print(stdmap3, tree3, rtree3);
+
+	std::cout << "self copy assignments of copy-assigned" << std::endl;
+	const auto& stdmap3self = stdmap3;
+	const auto& tree3self = tree3;
+	const auto& rtree3self = rtree3;
+	stdmap3 = stdmap3self;
+	tree3 = tree3self;
+	rtree3 = rtree3self;
+
+	std::cout << std::endl;
+	std::cout << "self copy-assigned:" << std::endl;
+	print(stdmap3, tree3, rtree3);
 	
 	std::cout << "move constructors from copy-assigned" << std::endl;
 	std::map<std::string, int> stdmap4{std::move(stdmap3)};
@@ -178,6 +200,16 @@ int main() {
 	rtree2.balance();
 	
 	std::cout << "tree depth: " << tree2.depth() << " rtree depth: " << rtree2.depth() << std::endl;
+	std::cout << "copy of tree and balance with 4 threads (sequential below " << bst<std::string, int>::parallel_threshold << " nodes per thread)" << std::endl;
+	bst<std::string, int> ptree{tree2, 4};
+	ptree.balance(4);
+	std::cout << "ptree depth: " << ptree.depth() << " size: " << ptree.size() << std::endl;
+	bst<int, int> listtree{};
+	for (auto i = 0; i < 1000000; ++i) {
+		listtree.emplace_hint(listtree.end(), i, i);
+	}
+	auto listtree2{listtree};
+	std::cout << "copy of a list-shaped tree of " << listtree2.size() << " elements, depth: " << listtree2.depth() << std::endl;
 		
 	std::cout << std::endl;
 	std::cout << "balanced" << std::endl;
@@ -188,6 +220,229 @@ int main() {
 	invertValues(stdmap2, tree2, rtree2);
 	print(stdmap2, tree2, rtree2);
 	
+	std::cout << std::endl;
+	std::cout << "bulk load from the sorted stdmap" << std::endl;
+	bst<std::string, int> sorted_tree{sorted_unique, stdmap2.begin(), stdmap2.end()};
+	std::cout << "sorted_tree: " << sorted_tree << std::endl;
+	std::cout << "sorted_tree depth: " << sorted_tree.depth() << std::endl;
+	std::cout << "sorted_tree shape: " << sorted_tree.shape_stats() << std::endl;
+	std::cout << "hinted insertions from 60 to 65 into sorted_tree" << std::endl;
+	auto hint = sorted_tree.end();
+	for (auto i = 60; i <= 65; ++i) {
+		hint = sorted_tree.insert(hint, std::make_pair(std::to_string(i), i));
+	}
+	sorted_tree.emplace_hint(sorted_tree.begin(), "00", 0);
+	std::cout << "sorted_tree: " << sorted_tree << std::endl;
+	std::cout << "try_emplace of 60 (present) and 66 (absent) into sorted_tree" << std::endl;
+	std::cout << "60 inserted: " << sorted_tree.try_emplace("60", -60).second
+		<< " 66 inserted: " << sorted_tree.try_emplace("66", 66).second << std::endl;
+	std::cout << "sorted_tree[\"60\"]: " << sorted_tree["60"] << " sorted_tree[\"66\"]: " << sorted_tree["66"] << std::endl;
+	
+	std::cout << std::endl;
+	std::cout << "batch search of 10, 42, 11, 5 in the balanced trees" << std::endl;
+	std::vector<std::string> keys{"10", "42", "11", "5"};
+	std::vector<bst<std::string, int>::iterator> hits{};
+	std::vector<bst<std::string, int, std::greater<std::string>>::iterator> rhits{};
+	tree2.find_many(keys.begin(), keys.end(), std::back_inserter(hits));
+	rtree2.find_many(keys.begin(), keys.end(), std::back_inserter(rhits));
+	for (std::size_t i = 0; i < keys.size(); ++i) {
+		std::cout << keys[i] << " tree: " << (hits[i] != tree2.end()) << " rtree: " << (rhits[i] != rtree2.end()) << std::endl;
+	}
+	
+	std::cout << std::endl;
+	std::cout << "concurrent tree: a writer thread inserts from 0 to 10 while the main thread reads" << std::endl;
+	concurrent_bst<std::string, int> ctree{};
+	std::thread writer{[&ctree]() {
+		for (auto i = 0; i <= 10; ++i) {
+			ctree.insert(std::make_pair(std::to_string(i), i));
+		}
+	}};
+	auto seen = ctree.size();
+	writer.join();
+	std::cout << "size seen while writing is at most 11: " << (seen <= 11) << " final size: " << ctree.size()
+		<< " find(\"7\"): " << ctree.find("7").value_or(-1) << " find(\"70\"): " << ctree.find("70").value_or(-1) << std::endl;
+	ctree.read([](const auto& tree) {
+		std::cout << "ctree: " << tree << std::endl;
+		return tree.size();
+	});
+	
+	std::cout << std::endl;
+	std::cout << "frozen snapshots of the balanced trees" << std::endl;
+	frozen_bst<std::string, int> frozen{tree2};
+	frozen_bst<std::string, int, std::greater<std::string>> rfrozen{rtree2};
+	std::cout << "frozen: " << frozen << std::endl;
+	std::cout << "rfrozen: " << rfrozen << std::endl;
+	search = 42;
+	std::cout << "frozen.find(" << search << ") != frozen.end(): " << (frozen.find(std::to_string(search)) != frozen.end()) << std::endl;
+	std::cout << "rfrozen.find(" << search << ") != rfrozen.end(): " << (rfrozen.find(std::to_string(search)) != rfrozen.end()) << std::endl;
+	search = 11;
+	std::cout << "frozen.find(" << search << ") != frozen.end(): " << (frozen.find(std::to_string(search)) != frozen.end()) << std::endl;
+	std::cout << "rfrozen.find(" << search << ") != rfrozen.end(): " << (rfrozen.find(std::to_string(search)) != rfrozen.end()) << std::endl;
+	
+	std::cout << std::endl;
+	std::cout << "saving a tree of squares from 0 to 10 and mapping the file" << std::endl;
+	bst<int, int> squares{};
+	for (auto i = 0; i <= 10; ++i) {
+		squares[i] = i * i;
+	}
+	mapped_bst<int, int>::save(squares, "test_bst_mapped.bin");
+	{
+		mapped_bst<int, int> mapped{"test_bst_mapped.bin"};
+		std::cout << "mapped: " << mapped << std::endl;
+		std::cout << "mapped.find(7)->second: " << mapped.find(7)->second << std::endl;
+		bst<int, int, std::less<int>, red_black> loaded{sorted_unique, mapped.begin(), mapped.end()};
+		std::cout << "loaded: " << loaded << " depth: " << loaded.depth() << std::endl;
+		std::cout << "loaded through dump: ";
+		loaded.dump(std::cout);
+		std::cout << std::endl;
+	}
+	std::remove("test_bst_mapped.bin");
+	bst<int, double> fractions{};
+	for (auto i = 1; i <= 4; ++i) {
+		fractions[i] = 1.0 / (3 * i);
+	}
+	fractions[5] = 1e20;
+	std::cout << "fractions: " << fractions << std::endl;
+	std::cout << "fractions through dump: ";
+	fractions.dump(std::cout);
+	std::cout << std::endl;
+
+	std::cout << std::endl;
+	std::cout << "self-balancing trees: inserting from 0 to 50" << std::endl;
+	bst<std::string, int, std::less<std::string>, red_black> rbtree{};
+	bst<std::string, int, std::less<std::string>, avl> avltree{};
+	for (auto i = 0; i <= 50; ++i) {
+		rbtree.insert(std::make_pair(std::to_string(i), i));
+		avltree[std::to_string(i)] = i;
+	}
+	std::cout << "rbtree: " << rbtree << std::endl;
+	std::cout << "avltree: " << avltree << std::endl;
+	std::cout << "rbtree depth: " << rbtree.depth() << " avltree depth: " << avltree.depth() << std::endl;
+	std::cout << "erasing the even keys, and from 31 to 39, from rbtree and avltree" << std::endl;
+	for (auto i = 0; i <= 50; i += 2) {
+		rbtree.erase(std::to_string(i));
+		avltree.erase(avltree.find(std::to_string(i)));
+	}
+	rbtree.erase(rbtree.find("31"), rbtree.find("41"));
+	avltree.erase(avltree.find("31"), avltree.find("41"));
+	std::cout << "rbtree: " << rbtree << std::endl;
+	std::cout << "avltree: " << avltree << std::endl;
+	std::cout << "rbtree depth: " << rbtree.depth() << " avltree depth: " << avltree.depth() << std::endl;
+	std::cout << "rbtree lower_bound(\"30\"): " << rbtree.lower_bound("30")->first << " upper_bound(\"41\"): " << rbtree.upper_bound("41")->first
+		<< " equal_range(\"43\") length: " << std::distance(rbtree.equal_range("43").first, rbtree.equal_range("43").second) << std::endl;
+	std::cout << "rbtree range [\"2\", \"3\"): ";
+	for (const auto& p : rbtree.range("2", "3")) {
+		std::cout << "(" << p.first << ": " << p.second << "), ";
+	}
+	std::cout << std::endl;
+	std::cout << "avltree in reverse: ";
+	for (auto iter = avltree.rbegin(); iter != avltree.rend(); ++iter) {
+		std::cout << "(" << iter->first << ": " << iter->second << "), ";
+	}
+	std::cout << std::endl;
+	std::cout << "avltree last element: " << (--avltree.end())->first << std::endl;
+	std::cout << "order statistics on a copy of avltree" << std::endl;
+	bst<std::string, int, std::less<std::string>, order_statistics<avl>> ostree{};
+	for (const auto& p : avltree) {
+		ostree.insert(p);
+	}
+	std::cout << "ostree nth(0): " << ostree.nth(0)->first << " nth(10): " << ostree.nth(10)->first
+		<< " rank(\"30\"): " << ostree.rank("30") << " distance(begin, find(\"5\")): " << ostree.distance(ostree.begin(), ostree.find("5")) << std::endl;
+	
+	std::cout << std::endl;
+	std::cout << "transparent comparator: lookups by string_view and const char*" << std::endl;
+	bst<std::string, int, std::less<>> ttree{};
+	for (auto i = 0; i <= 10; ++i) {
+		ttree[std::to_string(i)] = i;
+	}
+	std::string_view view{"7"};
+	std::cout << "ttree.find(string_view 7)->second: " << ttree.find(view)->second << std::endl;
+	std::cout << "ttree.lower_bound(\"15\")->first: " << ttree.lower_bound("15")->first << std::endl;
+	ttree[std::string_view{"42"}] = 42;
+	std::cout << "ttree.erase(\"0\"): " << ttree.erase("0") << " ttree: " << ttree << std::endl;
+
+	std::cout << std::endl;
+	std::cout << "three-way comparator: one comparison per level" << std::endl;
+	bst<std::string, int, three_way_less<std::string>, red_black> three_way_tree{};
+	for (auto i = 0; i <= 10; ++i) {
+		three_way_tree[std::to_string(i)] = i;
+	}
+	std::cout << "three_way_tree: " << three_way_tree << std::endl;
+	std::cout << "three_way_tree.find(\"5\")->second: " << three_way_tree.find("5")->second << std::endl;
+
+	std::cout << std::endl;
+	std::cout << "set operations between the multiples of 2 and of 3 up to 20" << std::endl;
+	bst<int, int, std::less<int>, red_black> twos{}, threes{};
+	for (auto i = 0; i <= 20; ++i) {
+		if (i % 2 == 0) {
+			twos[i] = 2;
+		}
+		if (i % 3 == 0) {
+			threes[i] = 3;
+		}
+	}
+	auto intersection{twos};
+	intersection.intersect_with(threes);
+	auto difference{twos};
+	difference.difference(threes);
+	auto union_tree{twos};
+	union_tree.union_with(threes);
+	std::cout << "intersection: " << intersection << std::endl;
+	std::cout << "difference: " << difference << std::endl;
+	std::cout << "union: " << union_tree << " depth: " << union_tree.depth() << std::endl;
+	twos.merge(threes);
+	std::cout << "twos after merge: " << twos << std::endl;
+	std::cout << "threes after merge: " << threes << std::endl;
+
+	std::cout << std::endl;
+	std::cout << "arena-allocated tree: inserting from 0 to 10, copying and clearing the original" << std::endl;
+	bst<std::string, int, std::less<std::string>, no_balancing, arena_allocator<std::pair<const std::string, int>>> arenatree{};
+	for (auto i = 0; i <= 10; ++i) {
+		arenatree.emplace(std::to_string(i), i);
+	}
+	auto arenatree2{arenatree};
+	std::cout << "emplace of the pair (5, -5) into the copy, 5 being present, inserted: "
+		<< arenatree2.emplace(std::make_pair(std::string{"5"}, -5)).second << std::endl;
+	arenatree.clear();
+	std::cout << "arenatree: " << arenatree << std::endl;
+	std::cout << "arenatree copy: " << arenatree2 << std::endl;
+
+	std::cout << std::endl;
+	std::cout << "btree with 8 keys per node: mapping the squares of 0 to 30 to their roots, inserted in reverse order" << std::endl;
+	btree<int, int, std::less<int>, 8> roots{};
+	for (auto i = 30; i >= 0; --i) {
+		roots[i * i] = i;
+	}
+	std::cout << "roots: " << roots << " depth: " << roots.depth() << std::endl;
+	std::cout << "roots.find(144): " << roots.find(144)->second << std::endl;
+	std::cout << "roots.lower_bound(500): " << roots.lower_bound(500)->first << std::endl;
+	std::cout << "largest square: " << std::prev(roots.end())->first << std::endl;
+
+	std::cout << std::endl;
+	std::cout << "prefix_bst with keys of 3 words: inserting {0, 0, i} for i from 0 to 5 and {1, 2, i} for i from 0 to 2" << std::endl;
+	prefix_bst<int, 3, int> prefixed{};
+	for (auto i = 5; i >= 0; --i) {
+		prefixed[{0, 0, i}] = i;
+	}
+	for (auto i = 0; i <= 2; ++i) {
+		prefixed[{1, 2, i}] = 10 * i;
+	}
+	std::cout << "prefixed: " << prefixed << " prefixes: " << prefixed.prefixes() << std::endl;
+	std::cout << "prefixed.lower_bound({0, 0, 6}): " << prefixed.lower_bound({0, 0, 6})->second << std::endl;
+	prefixed.erase({0, 0, 3});
+	std::cout << "prefixed after erasing {0, 0, 3}: " << prefixed << std::endl;
+
+	std::cout << std::endl;
+	std::cout << "red_black tree with prefetched searches: inserting from 0 to 20 by 2" << std::endl;
+	bst<int, int, std::less<int>, prefetched_search<red_black>> prefetched{};
+	for (auto i = 0; i <= 20; i += 2) {
+		prefetched[i] = i;
+	}
+	std::cout << "prefetched: " << prefetched << " depth: " << prefetched.depth() << std::endl;
+	std::cout << "prefetched.find(8) != prefetched.end(): " << (prefetched.find(8) != prefetched.end()) << std::endl;
+	std::cout << "prefetched.find(9) != prefetched.end(): " << (prefetched.find(9) != prefetched.end()) << std::endl;
+	std::cout << "prefetched.lower_bound(9): " << prefetched.lower_bound(9)->first << std::endl;
+	
 	stdmap.clear();
 	tree.clear();
 	rtree.clear();